@@ -122,6 +122,38 @@ serial_putc (uint8_t byte) {
 	intr_set_level (old_level);
 }
 
+/* Sends the N bytes in BUFFER to the serial port.  Like calling
+   serial_putc() for each byte, but interrupts are toggled and the
+   interrupt enable register is written once per buffer rather
+   than once per byte, except when the transmit queue fills up. */
+void
+serial_putbuf (const char *buffer, size_t n) {
+	enum intr_level old_level = intr_disable ();
+
+	if (mode != QUEUE) {
+		if (mode == UNINIT)
+			init_poll ();
+		while (n-- > 0)
+			putc_poll (*buffer++);
+	} else {
+		while (n-- > 0) {
+			if (intq_full (&txq)) {
+				if (old_level == INTR_OFF)
+					putc_poll (intq_getc (&txq));
+				else {
+					/* Let the transmitter drain the queue while
+					   intq_putc() waits for room. */
+					write_ier ();
+				}
+			}
+			intq_putc (&txq, *buffer++);
+		}
+		write_ier ();
+	}
+
+	intr_set_level (old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
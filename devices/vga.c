@@ -28,6 +28,7 @@ static uint8_t (*fb)[COL_CNT][2];
 static void clear_row (size_t y);
 static void cls (void);
 static void newline (void);
+static void putc_no_cursor (int);
 static void move_cursor (void);
 static void find_cursor (size_t *x, size_t *y);
 
@@ -52,7 +53,31 @@ vga_putc (int c) {
 	enum intr_level old_level = intr_disable ();
 
 	init ();
+	putc_no_cursor (c);
+	move_cursor ();
+
+	intr_set_level (old_level);
+}
+
+/* Writes the N characters in BUFFER to the VGA text display.
+   The hardware cursor, which costs several port writes, is
+   moved once at the end. */
+void
+vga_putbuf (const char *buffer, size_t n) {
+	enum intr_level old_level = intr_disable ();
+
+	init ();
+	while (n-- > 0)
+		putc_no_cursor (*buffer++);
+	move_cursor ();
 
+	intr_set_level (old_level);
+}
+
+/* Writes C to the framebuffer without moving the hardware
+   cursor.  Interrupts must be off. */
+static void
+putc_no_cursor (int c) {
 	switch (c) {
 		case '\n':
 			newline ();
@@ -84,11 +109,6 @@ vga_putc (int c) {
 				newline ();
 			break;
 	}
-
-	/* Update cursor position. */
-	move_cursor ();
-
-	intr_set_level (old_level);
 }
 
 /* Clears the screen and moves the cursor to the upper left. */
@@ -1,10 +1,12 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir {
@@ -19,10 +21,53 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
+/* Directory entries read from disk at once. */
+#define DIR_READ_CNT (DISK_SECTOR_SIZE / sizeof (struct dir_entry))
+
+/* In-memory index of a directory's entries, so that looking up a
+ * name does not read the whole directory.  Indexes are kept for
+ * the DIR_INDEX_CNT most recently used directories, whether or
+ * not they are open.  The on-disk format is unchanged, so slots
+ * are reused and dir_readdir() returns entries in the same order
+ * as before. */
+#define DIR_INDEX_CNT 8
+
+struct dir_index {
+	struct list_elem elem;              /* Element in dir_indexes. */
+	disk_sector_t sector;               /* Sector of directory inode. */
+	struct hash names;                  /* struct dir_name's, by name. */
+	off_t free_ofs;                     /* Lowest free slot, or EOF. */
+};
+
+/* An entry in use, as recorded in a struct dir_index. */
+struct dir_name {
+	struct hash_elem elem;              /* Element in dir_index names. */
+	disk_sector_t inode_sector;         /* Sector number of header. */
+	off_t ofs;                          /* Offset of entry in directory. */
+	char name[NAME_MAX + 1];            /* Null terminated file name. */
+};
+
+static struct list dir_indexes;         /* Most recently used first. */
+static size_t dir_index_cnt;            /* Number of dir_indexes. */
+static struct lock dir_lock;            /* Serializes directory updates. */
+
+static void dir_index_drop (disk_sector_t sector);
+
+/* Initializes the directory module. */
+void
+dir_init (void) {
+	list_init (&dir_indexes);
+	lock_init (&dir_lock);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (disk_sector_t sector, size_t entry_cnt) {
+	/* SECTOR may have held a directory that was since removed. */
+	lock_acquire (&dir_lock);
+	dir_index_drop (sector);
+	lock_release (&dir_lock);
 	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
 }
 
@@ -71,20 +116,189 @@ dir_get_inode (struct dir *dir) {
 	return dir->inode;
 }
 
+static uint64_t
+dir_name_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_string (hash_entry (e, struct dir_name, elem)->name);
+}
+
+static bool
+dir_name_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return strcmp (hash_entry (a, struct dir_name, elem)->name,
+			hash_entry (b, struct dir_name, elem)->name) < 0;
+}
+
+static void
+dir_name_free (struct hash_elem *e, void *aux UNUSED) {
+	free (hash_entry (e, struct dir_name, elem));
+}
+
+/* Frees INDEX, which must not be in dir_indexes. */
+static void
+dir_index_free (struct dir_index *index) {
+	hash_destroy (&index->names, dir_name_free);
+	free (index);
+}
+
+/* Discards the index of the directory whose inode is in SECTOR, if
+ * there is one. */
+static void
+dir_index_drop (disk_sector_t sector) {
+	struct list_elem *e;
+
+	for (e = list_begin (&dir_indexes); e != list_end (&dir_indexes);
+			e = list_next (e)) {
+		struct dir_index *index = list_entry (e, struct dir_index, elem);
+		if (index->sector == sector) {
+			list_remove (e);
+			dir_index_cnt--;
+			dir_index_free (index);
+			return;
+		}
+	}
+}
+
+/* Records the entry E, at offset OFS, in INDEX.
+ * Returns false if memory allocation fails. */
+static bool
+dir_index_insert (struct dir_index *index, const struct dir_entry *e,
+		off_t ofs) {
+	struct dir_name *n = malloc (sizeof *n);
+	if (n == NULL)
+		return false;
+	n->inode_sector = e->inode_sector;
+	n->ofs = ofs;
+	strlcpy (n->name, e->name, sizeof n->name);
+	hash_insert (&index->names, &n->elem);
+	return true;
+}
+
+/* Returns the offset of the first free slot in INODE at or after
+ * OFS, or the end of the directory if there is none. */
+static off_t
+find_free_slot (struct inode *inode, off_t ofs) {
+	struct dir_entry e;
+
+	for (; inode_read_at (inode, &e, sizeof e, ofs) == sizeof e;
+			ofs += sizeof e)
+		if (!e.in_use)
+			break;
+	return ofs;
+}
+
+/* Reads every entry of directory INODE into a new index.
+ * Returns the index, or a null pointer if memory allocation
+ * fails. */
+static struct dir_index *
+dir_index_build (struct inode *inode) {
+	struct dir_index *index = malloc (sizeof *index);
+	struct dir_entry *entries = malloc (DIR_READ_CNT * sizeof *entries);
+	off_t ofs = 0;
+	off_t bytes;
+
+	if (index == NULL || entries == NULL
+			|| !hash_init (&index->names, dir_name_hash, dir_name_less, NULL)) {
+		free (index);
+		free (entries);
+		return NULL;
+	}
+	index->sector = inode_get_inumber (inode);
+	index->free_ofs = -1;
+
+	/* Read a sector's worth of entries at a time. */
+	while ((bytes = inode_read_at (inode, entries,
+					DIR_READ_CNT * sizeof *entries, ofs))
+			>= (off_t) sizeof *entries) {
+		for (size_t i = 0; i < bytes / sizeof *entries;
+				i++, ofs += sizeof *entries) {
+			if (!entries[i].in_use) {
+				if (index->free_ofs < 0)
+					index->free_ofs = ofs;
+			} else if (!dir_index_insert (index, &entries[i], ofs)) {
+				free (entries);
+				dir_index_free (index);
+				return NULL;
+			}
+		}
+	}
+	if (index->free_ofs < 0)
+		index->free_ofs = ofs;
+	free (entries);
+	return index;
+}
+
+/* Returns the index for DIR, building it if necessary, or a null
+ * pointer if memory is short.  Must be called with dir_lock held. */
+static struct dir_index *
+dir_index_get (const struct dir *dir) {
+	disk_sector_t sector = inode_get_inumber (dir->inode);
+	struct dir_index *index;
+	struct list_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&dir_lock));
+
+	for (e = list_begin (&dir_indexes); e != list_end (&dir_indexes);
+			e = list_next (e)) {
+		index = list_entry (e, struct dir_index, elem);
+		if (index->sector == sector) {
+			list_remove (e);
+			list_push_front (&dir_indexes, e);
+			return index;
+		}
+	}
+
+	index = dir_index_build (dir->inode);
+	if (index == NULL)
+		return NULL;
+	list_push_front (&dir_indexes, &index->elem);
+	if (++dir_index_cnt > DIR_INDEX_CNT) {
+		dir_index_cnt--;
+		dir_index_free (list_entry (list_pop_back (&dir_indexes),
+					struct dir_index, elem));
+	}
+	return index;
+}
+
 /* Searches DIR for a file with the given NAME.
  * If successful, returns true, sets *EP to the directory entry
  * if EP is non-null, and sets *OFSP to the byte offset of the
  * directory entry if OFSP is non-null.
- * otherwise, returns false and ignores EP and OFSP. */
+ * otherwise, returns false and ignores EP and OFSP.
+ * Must be called with dir_lock held. */
 static bool
 lookup (const struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
+	struct dir_index *index;
 	struct dir_entry e;
 	size_t ofs;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	index = dir_index_get (dir);
+	if (index != NULL) {
+		struct dir_name key;
+		struct hash_elem *found;
+
+		if (strlen (name) > NAME_MAX)
+			return false;
+		strlcpy (key.name, name, sizeof key.name);
+		found = hash_find (&index->names, &key.elem);
+		if (found == NULL)
+			return false;
+
+		struct dir_name *n = hash_entry (found, struct dir_name, elem);
+		if (ep != NULL) {
+			ep->inode_sector = n->inode_sector;
+			strlcpy (ep->name, n->name, sizeof ep->name);
+			ep->in_use = true;
+		}
+		if (ofsp != NULL)
+			*ofsp = n->ofs;
+		return true;
+	}
+
+	/* No memory for an index: scan the directory. */
 	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 			ofs += sizeof e)
 		if (e.in_use && !strcmp (name, e.name)) {
@@ -109,10 +323,12 @@ dir_lookup (const struct dir *dir, const char *name,
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	lock_acquire (&dir_lock);
 	if (lookup (dir, name, &e, NULL))
 		*inode = inode_open (e.inode_sector);
 	else
 		*inode = NULL;
+	lock_release (&dir_lock);
 
 	return *inode != NULL;
 }
@@ -125,6 +341,7 @@ dir_lookup (const struct dir *dir, const char *name,
  * error occurs. */
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
+	struct dir_index *index;
 	struct dir_entry e;
 	off_t ofs;
 	bool success = false;
@@ -136,6 +353,8 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
+	lock_acquire (&dir_lock);
+
 	/* Check that NAME is not in use. */
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
@@ -147,10 +366,8 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	 * inode_read_at() will only return a short read at end of file.
 	 * Otherwise, we'd need to verify that we didn't get a short
 	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (!e.in_use)
-			break;
+	index = dir_index_get (dir);
+	ofs = find_free_slot (dir->inode, index != NULL ? index->free_ofs : 0);
 
 	/* Write slot. */
 	e.in_use = true;
@@ -158,7 +375,15 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	e.inode_sector = inode_sector;
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
+	if (success && index != NULL) {
+		if (dir_index_insert (index, &e, ofs))
+			index->free_ofs = find_free_slot (dir->inode, ofs + sizeof e);
+		else
+			dir_index_drop (index->sector);
+	}
+
 done:
+	lock_release (&dir_lock);
 	return success;
 }
 
@@ -167,6 +392,7 @@ done:
  * which occurs only if there is no file with the given NAME. */
 bool
 dir_remove (struct dir *dir, const char *name) {
+	struct dir_index *index;
 	struct dir_entry e;
 	struct inode *inode = NULL;
 	bool success = false;
@@ -175,6 +401,8 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	lock_acquire (&dir_lock);
+
 	/* Find directory entry. */
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
@@ -193,7 +421,24 @@ dir_remove (struct dir *dir, const char *name) {
 	inode_remove (inode);
 	success = true;
 
+	/* Forget the entry, and the removed file's own index in case it
+	 * was a directory. */
+	index = dir_index_get (dir);
+	if (index != NULL) {
+		struct dir_name key;
+		struct hash_elem *found;
+
+		strlcpy (key.name, e.name, sizeof key.name);
+		found = hash_delete (&index->names, &key.elem);
+		if (found != NULL)
+			dir_name_free (found, NULL);
+		if (ofs < index->free_ofs)
+			index->free_ofs = ofs;
+	}
+	dir_index_drop (e.inode_sector);
+
 done:
+	lock_release (&dir_lock);
 	inode_close (inode);
 	return success;
 }
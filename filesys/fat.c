@@ -1,4 +1,5 @@
 #include "filesys/fat.h"
+#include <bitmap.h>
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "threads/malloc.h"
@@ -23,15 +24,24 @@ struct fat_fs {
 	unsigned int fat_length;
 	disk_sector_t data_start;
 	cluster_t last_clst;
-	struct lock write_lock;
+	struct lock write_lock;     /* Guards fat, free_map, alloc_hint, dirty. */
+	struct bitmap *free_map;    /* One bit per cluster, set if in use. */
+	cluster_t alloc_hint;       /* Where the next free-cluster search starts. */
+	cluster_t tail_from;        /* Cluster last passed to fat_create_chain... */
+	cluster_t tail;             /* ...and the tail of its chain. */
+	struct bitmap *dirty;       /* FAT sectors changed since written. */
 };
 
 static struct fat_fs *fat_fs;
 
+unsigned int fat_cluster_sectors = SECTORS_PER_CLUSTER;
+
 void fat_boot_create (void);
 void fat_fs_init (void);
-cluster_t fat_get_index(cluster_t val);
-cluster_t fat_iter_chain(cluster_t clst, cluster_t target_value);
+static void free_map_build (void);
+static cluster_t fat_alloc_cluster (void);
+static cluster_t fat_chain_tail (cluster_t clst);
+static void dirty_map_create (bool dirty);
 
 void
 fat_init (void) {
@@ -51,6 +61,7 @@ fat_init (void) {
 	if (fat_fs->bs.magic != FAT_MAGIC)
 		fat_boot_create ();
 	fat_fs_init ();
+	lock_init (&fat_fs->write_lock);
 }
 
 void
@@ -80,6 +91,8 @@ fat_open (void) {
 			free (bounce);
 		}
 	}
+	free_map_build ();
+	dirty_map_create (false);
 }
 
 void
@@ -92,27 +105,61 @@ fat_close (void) {
 	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
 	free (bounce);
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
+	// Write the parts of the FAT that changed since last written
+	fat_writeback ();
+}
+
+/* Creates the map of dirty FAT sectors, with every sector marked
+ * DIRTY. */
+static void
+dirty_map_create (bool dirty) {
+	if (fat_fs->dirty == NULL)
+		fat_fs->dirty = bitmap_create (fat_fs->bs.fat_sectors);
+	if (fat_fs->dirty == NULL)
+		PANIC ("FAT dirty map creation failed");
+	bitmap_set_all (fat_fs->dirty, dirty);
+}
+
+/* Writes the FAT sectors modified since they were last written to
+ * disk.  Called periodically in the background and when the file
+ * system is closed, so that the cost of both is proportional to
+ * the number of changes rather than to the size of the FAT. */
+void
+fat_writeback (void) {
+	size_t fat_size_in_bytes;
+	uint8_t *bounce = NULL;
+	size_t i = 0;
+
+	if (fat_fs == NULL || fat_fs->dirty == NULL)
+		return;
+	fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
+
+	for (;;) {
+		/* Snapshot one dirty sector under the lock, so that it can
+		 * be written while the FAT keeps changing.  A change made
+		 * after the snapshot marks the sector dirty again. */
+		lock_acquire (&fat_fs->write_lock);
+		i = bitmap_scan_and_flip (fat_fs->dirty, i, 1, true);
+		if (i != BITMAP_ERROR) {
+			size_t ofs = i * DISK_SECTOR_SIZE;
+			size_t len = fat_size_in_bytes - ofs;
+			if (len > DISK_SECTOR_SIZE)
+				len = DISK_SECTOR_SIZE;
 			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
+				bounce = malloc (DISK_SECTOR_SIZE);
+			if (bounce == NULL)
+				PANIC ("FAT writeback failed");
+			memset (bounce + len, 0, DISK_SECTOR_SIZE - len);
+			memcpy (bounce, (uint8_t *) fat_fs->fat + ofs, len);
 		}
+		lock_release (&fat_fs->write_lock);
+
+		if (i == BITMAP_ERROR)
+			break;
+		disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
+		i++;
 	}
+	free (bounce);
 }
 
 void
@@ -125,26 +172,32 @@ fat_create (void) {
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT creation failed");
+	free_map_build ();
+	dirty_map_create (true);
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
 
 	// Fill up ROOT_DIR_CLUSTER region with 0
-	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
+	uint8_t *buf = calloc (1, fat_cluster_size ());
 	if (buf == NULL)
 		PANIC ("FAT create failed due to OOM");
-	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
+	fat_write_cluster (ROOT_DIR_CLUSTER, buf);
 	free (buf);
 }
 
 void
 fat_boot_create (void) {
+	unsigned int spc = fat_cluster_sectors;
+	if (spc == 0 || spc > DISK_MAX_SECTORS || (spc & (spc - 1)) != 0)
+		PANIC ("bad cluster size: %u sectors", spc);
+
 	unsigned int fat_sectors =
 	    (disk_size (filesys_disk) - 1)
-	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
+	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * spc + 1) + 1;
 	fat_fs->bs = (struct fat_boot){
 	    .magic = FAT_MAGIC,
-	    .sectors_per_cluster = SECTORS_PER_CLUSTER,
+	    .sectors_per_cluster = spc,
 	    .total_sectors = disk_size (filesys_disk),
 	    .fat_start = 1,
 	    .fat_sectors = fat_sectors,
@@ -155,8 +208,9 @@ fat_boot_create (void) {
 void
 fat_fs_init (void) {
 	/* TODO: Your code goes here. */
-	fat_fs->fat_length = fat_fs->bs.fat_sectors / SECTORS_PER_CLUSTER;
-	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->fat_length;
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+	fat_fs->fat_length = (fat_fs->bs.total_sectors - fat_fs->data_start)
+	                     / fat_fs->bs.sectors_per_cluster;
 
 }
 
@@ -164,69 +218,100 @@ fat_fs_init (void) {
 /* FAT handling                                                               */
 /*----------------------------------------------------------------------------*/
 
+/* Builds the free-cluster bitmap from the FAT.  Cluster 0 is never
+ * handed out, since 0 means "no cluster" to fat_create_chain(). */
+static void
+free_map_build (void) {
+	if (fat_fs->free_map == NULL)
+		fat_fs->free_map = bitmap_create (fat_fs->fat_length);
+	if (fat_fs->free_map == NULL)
+		PANIC ("FAT free map creation failed");
+
+	bitmap_mark (fat_fs->free_map, 0);
+	for (cluster_t clst = 1; clst < fat_fs->fat_length; clst++)
+		bitmap_set (fat_fs->free_map, clst, fat_fs->fat[clst] != 0);
+	fat_fs->alloc_hint = 1;
+	fat_fs->tail_from = fat_fs->tail = 0;
+}
+
+/* Claims a free cluster and returns it, or 0 if the disk is full.
+ * Searches from just past the previous allocation (next fit), so
+ * consecutive allocations need not rescan the clusters in use.  The
+ * search and the claim happen under write_lock, like every other
+ * change to the free map, so two allocators never get the same
+ * cluster. */
+static cluster_t
+fat_alloc_cluster (void) {
+	size_t clst;
+
+	lock_acquire (&fat_fs->write_lock);
+	clst = bitmap_scan_and_flip (fat_fs->free_map, fat_fs->alloc_hint, 1,
+			false);
+	if (clst == BITMAP_ERROR)
+		clst = bitmap_scan_and_flip (fat_fs->free_map, 1, 1, false);
+	if (clst != BITMAP_ERROR)
+		fat_fs->alloc_hint = clst + 1 < fat_fs->fat_length ? clst + 1 : 1;
+	lock_release (&fat_fs->write_lock);
+	return clst != BITMAP_ERROR ? clst : 0;
+}
+
+/* Returns the last cluster of the chain that CLST belongs to,
+ * starting from CLST. */
+static cluster_t
+fat_chain_tail (cluster_t clst) {
+	cluster_t next;
+
+	/* Appending callers usually pass the same cluster each time, or
+	 * the cluster returned by the previous call. */
+	if (clst == fat_fs->tail_from && fat_get (fat_fs->tail) == EOChain)
+		return fat_fs->tail;
+	while ((next = fat_get (clst)) != EOChain)
+		clst = next;
+	return clst;
+}
+
 /* Add a cluster to the chain.
  * If CLST is 0, start a new chain.
  * Returns 0 if fails to allocate a new cluster. */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
-	cluster_t index;
-	if (clst == 0){
-		index = fat_get_index(0);
-		fat_put(index, EOChain);
-		return index;
-	}
-
-	index = fat_iter_chain(clst, EOChain);
-	if (index == 0){
-		return 0;
-	}
-	fat_put(index, clst);
-	fat_put(clst, EOChain);
-	return clst;
-}
+	cluster_t tail = clst != 0 ? fat_chain_tail (clst) : 0;
+	cluster_t new_clst = fat_alloc_cluster ();
 
-cluster_t
-fat_iter_chain(cluster_t clst, cluster_t target_value){
-	cluster_t value = fat_get(clst);
-	if(clst == EOChain){
+	if (new_clst == 0)
 		return 0;
+	fat_put (new_clst, EOChain);
+	if (tail != 0) {
+		fat_put (tail, new_clst);
+		fat_fs->tail_from = clst;
+		fat_fs->tail = new_clst;
 	}
-	if(value == target_value){
-		return clst;
-	}
-	return fat_iter_chain(value, target_value);
+	return new_clst;
 }
 
-cluster_t
-fat_get_index(cluster_t val){
-	for(cluster_t index = 0; index < fat_fs->fat_length ; index ++){
-		if(fat_get(index) == val){
-			return index;
-		}
-	}
-	return 0;
-}
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: Your code goes here. */
-	if (pclst == 0){
-		fat_put(clst, 0);
-		return;
+	while (clst != 0 && clst != EOChain) {
+		cluster_t next = fat_get (clst);
+		fat_put (clst, 0);
+		clst = next;
 	}
-
-	cluster_t index = fat_iter_chain(clst, EOChain);
-	fat_put(index, 0);
-	fat_put(pclst, EOChain);
+	if (pclst != 0)
+		fat_put (pclst, EOChain);
+	fat_fs->tail_from = fat_fs->tail = 0;
 }
 
 /* Update a value in the FAT table. */
 void
 fat_put (cluster_t clst, cluster_t val) {
 	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
 	fat_fs->fat[clst] = val;
+	bitmap_mark (fat_fs->dirty, clst * sizeof (cluster_t) / DISK_SECTOR_SIZE);
+	bitmap_set (fat_fs->free_map, clst, val != 0);
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Fetch a value in the FAT table. */
@@ -240,5 +325,27 @@ fat_get (cluster_t clst) {
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
 	/* TODO: Your code goes here. */
-	return clst + fat_fs->data_start;
+	return fat_fs->data_start + clst * fat_fs->bs.sectors_per_cluster;
+}
+
+/* Returns the size of a cluster in bytes. */
+size_t
+fat_cluster_size (void) {
+	return fat_fs->bs.sectors_per_cluster * DISK_SECTOR_SIZE;
+}
+
+/* Reads cluster CLST into BUFFER, which must have room for
+ * fat_cluster_size() bytes, with a single disk command. */
+void
+fat_read_cluster (cluster_t clst, void *buffer) {
+	disk_read_sectors (filesys_disk, cluster_to_sector (clst), buffer,
+	                   fat_fs->bs.sectors_per_cluster);
+}
+
+/* Writes fat_cluster_size() bytes from BUFFER to cluster CLST with
+ * a single disk command. */
+void
+fat_write_cluster (cluster_t clst, const void *buffer) {
+	disk_write_sectors (filesys_disk, cluster_to_sector (clst), buffer,
+	                    fat_fs->bs.sectors_per_cluster);
 }
@@ -201,8 +201,16 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 			break;
 
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
+			/* Read the whole run of full sectors directly into
+			 * caller's buffer with one disk command.  File data is
+			 * contiguous on disk. */
+			off_t run_left = size < inode_left ? size : inode_left;
+			size_t sector_cnt = run_left / DISK_SECTOR_SIZE;
+			if (sector_cnt > DISK_MAX_SECTORS)
+				sector_cnt = DISK_MAX_SECTORS;
+			disk_read_sectors (filesys_disk, sector_idx, buffer + bytes_read,
+					sector_cnt);
+			chunk_size = sector_cnt * DISK_SECTOR_SIZE;
 		} else {
 			/* Read sector into bounce buffer, then partially copy
 			 * into caller's buffer. */
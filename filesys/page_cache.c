@@ -1,9 +1,17 @@
 /* page_cache.c: Implementation of Page Cache (Buffer Cache). */
 
 #include "vm/vm.h"
+#include "devices/timer.h"
+#include "filesys/fat.h"
+#include "threads/thread.h"
+
+/* How often the worker writes back dirty file system metadata. */
+#define WRITEBACK_INTERVAL (TIMER_FREQ * 5)
+
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
 static void page_cache_destroy (struct page *page);
+static void page_cache_kworkerd (void *aux);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations page_cache_op = {
@@ -19,6 +27,8 @@ tid_t page_cache_workerd;
 void
 pagecache_init (void) {
 	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+	page_cache_workerd = thread_create ("page_cache_kworkerd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
 }
 
 /* Initialize the page cache */
@@ -46,5 +56,9 @@ page_cache_destroy (struct page *page) {
 
 /* Worker thread for page cache */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (WRITEBACK_INTERVAL);
+		fat_writeback ();
+	}
 }
@@ -14,15 +14,21 @@ typedef uint32_t cluster_t;  /* Index of a cluster within FAT. */
 #define EOChain 0x0FFFFFFF   /* End of cluster chain */
 
 /* Sectors of FAT information. */
-#define SECTORS_PER_CLUSTER 1 /* Number of sectors per cluster */
+#define SECTORS_PER_CLUSTER 8 /* Default sectors per cluster (one page) */
 #define FAT_BOOT_SECTOR 0     /* FAT boot sector. */
 #define ROOT_DIR_CLUSTER 1    /* Cluster for the root directory */
 
+/* Sectors per cluster for a file system formatted from now on.
+ * Set with the -cluster=N kernel option; an existing file system
+ * keeps the cluster size recorded in its boot sector. */
+extern unsigned int fat_cluster_sectors;
+
 void fat_init (void);
 void fat_open (void);
 void fat_close (void);
 void fat_create (void);
 void fat_close (void);
+void fat_writeback (void);
 
 cluster_t fat_create_chain (
     cluster_t clst /* Cluster # to stretch, 0: Create a new chain */
@@ -34,5 +40,8 @@ void fat_remove_chain (
 cluster_t fat_get (cluster_t clst);
 void fat_put (cluster_t clst, cluster_t val);
 disk_sector_t cluster_to_sector (cluster_t clst);
+size_t fat_cluster_size (void);
+void fat_read_cluster (cluster_t clst, void *buffer);
+void fat_write_cluster (cluster_t clst, const void *buffer);
 
 #endif /* filesys/fat.h */
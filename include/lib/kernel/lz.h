@@ -0,0 +1,23 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Fast LZ77 compression of small buffers, in the spirit of LZ4.
+
+   Buffers may be at most LZ_MAX_INPUT bytes long.  Compression
+   needs a scratch table of LZ_TABLE_SIZE entries, which is large
+   for a kernel stack, so the caller provides it. */
+
+#define LZ_MAX_INPUT 65535
+#define LZ_HASH_BITS 10
+#define LZ_TABLE_SIZE (1 << LZ_HASH_BITS)
+
+size_t lz_compress (const void *src, size_t src_size,
+		void *dst, size_t dst_size, uint16_t table[LZ_TABLE_SIZE]);
+bool lz_decompress (const void *src, size_t src_size,
+		void *dst, size_t dst_size);
+
+#endif /* lib/kernel/lz.h */
@@ -0,0 +1,8 @@
+#ifndef __LIB_MMAN_H
+#define __LIB_MMAN_H
+
+/* Flags that may be ORed into the WRITABLE argument of mmap(),
+ * which must otherwise be 0 or 1.  mmap() fails on unknown bits. */
+#define MAP_POPULATE 0x2        /* Read in the whole mapping up front. */
+
+#endif /* lib/mman.h */
@@ -36,6 +36,15 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Vectored and positional I/O. */
+	SYS_READV,                  /* Read from a file into several buffers. */
+	SYS_WRITEV,                 /* Write several buffers to a file. */
+	SYS_PREAD,                  /* Read from a file at a given offset. */
+	SYS_PWRITE,                 /* Write to a file at a given offset. */
+
+	SYS_SPAWN,                  /* Start a new process running a program. */
+	SYS_VMSTAT,                 /* Report this process's paging activity. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,15 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+#include <stddef.h>
+
+/* One buffer of a readv() or writev() request. */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Size of the buffer in bytes. */
+};
+
+/* Most buffers that one readv() or writev() accepts. */
+#define IOV_MAX 1024
+
+#endif /* lib/uio.h */
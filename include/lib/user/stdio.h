@@ -4,4 +4,12 @@
 int hprintf (int, const char *, ...) PRINTF_FORMAT (2, 3);
 int vhprintf (int, const char *, va_list) PRINTF_FORMAT (2, 0);
 
+/* Buffering modes for standard output, for stdout_setbuf(). */
+#define _IONBF 0        /* Unbuffered: every call writes at once. */
+#define _IOLBF 1        /* Line buffered: written at each new-line. */
+#define _IOFBF 2        /* Fully buffered: written when full. */
+
+void stdout_setbuf (int mode);
+void stdout_flush (void);
+
 #endif /* lib/user/stdio.h */
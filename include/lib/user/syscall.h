@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <mman.h>
+#include <uio.h>
+#include <vmstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -27,6 +30,7 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t fork (const char *thread_name);
 int exec (const char *file);
+pid_t spawn (const char *cmd_line);
 int wait (pid_t);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
@@ -40,9 +44,15 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int vmstat (struct vmstat *stat);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
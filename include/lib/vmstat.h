@@ -0,0 +1,14 @@
+#ifndef __LIB_VMSTAT_H
+#define __LIB_VMSTAT_H
+
+/* Paging activity of one process, as reported by vmstat(). */
+struct vmstat {
+	long long minor_faults;     /* Faults served without disk I/O. */
+	long long major_faults;     /* Faults that read a file or swap. */
+	long long swap_ins;         /* Pages brought back from swap. */
+	long long swap_outs;        /* Pages evicted to swap. */
+	long long fork_copies;      /* Pages copied for fork(). */
+	long long rss;              /* Pages resident in memory now. */
+};
+
+#endif /* lib/vmstat.h */
@@ -17,7 +17,14 @@ extern size_t user_page_limit;
 uint64_t palloc_init (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
+void *palloc_get_aligned (enum palloc_flags, size_t page_cnt, size_t align);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_start_zeroing (void);
+size_t palloc_user_page_cnt (void);
+size_t palloc_user_page_no (const void *kva);
+
+void zero_page (void *);
+void copy_page (void *dst, const void *src);
 
 #endif /* threads/palloc.h */
@@ -7,8 +7,12 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #ifdef VM
+#include <vmstat.h>
 #include "vm/vm.h"
 #endif
+#ifdef USERPROG
+#include "userprog/fdtable.h"
+#endif
 
 
 /* States in a thread's life cycle. */
@@ -28,7 +32,6 @@ typedef int tid_t;
 #define PRI_MIN 0                       /* Lowest priority. */
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
-#define MAX_FILE_DESCRIPTOR 3 * (1<<9)
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -102,8 +105,6 @@ struct thread {
 	struct lock *wait_lock;
 	struct list_elem priority_elem;
 	struct list priority_list;
-	struct file** file_fdt;
-	int last_fd;
 	void* user_rsp;
 	struct semaphore fork_sema;
 	struct semaphore wait_sema;
@@ -114,12 +115,14 @@ struct thread {
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4;                     /* Page map level 4 */
+	struct fd_table fdt;                /* Open files, by descriptor. */
 #endif
 	
 
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	struct vmstat vmstat;               /* Paging counters; see vm_get_stat(). */
 #endif
 	// USERPROG
 	struct list child_list;				/*자식 프로세스 리스트*/
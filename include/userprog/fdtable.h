@@ -0,0 +1,34 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct file;
+
+/* Most file descriptors one process may have open. */
+#define FD_MAX 1536
+
+/* A process's file descriptor table.
+ *
+ * Descriptors 0 and 1 are the console and never hold a file.  The
+ * table is allocated on the first open() and doubles as needed, so
+ * kernel threads and processes with few files stay small.  A bitmap
+ * of used slots, one bit per descriptor, finds the lowest free
+ * descriptor a 64-bit word at a time. */
+struct fd_table {
+	struct file **files;        /* Open file per descriptor, or NULL. */
+	uint64_t *used;             /* Bit set for each used descriptor. */
+	int size;                   /* Number of slots in FILES. */
+	int open_cnt;               /* Number of files open. */
+};
+
+void fd_table_init (struct fd_table *);
+int fd_table_install (struct fd_table *, struct file *);
+struct file *fd_table_get (const struct fd_table *, int fd);
+struct file *fd_table_remove (struct fd_table *, int fd);
+bool fd_table_copy (struct fd_table *dst, const struct fd_table *src);
+void fd_table_destroy (struct fd_table *);
+
+#endif /* userprog/fdtable.h */
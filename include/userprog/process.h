@@ -2,9 +2,23 @@
 #define USERPROG_PROCESS_H
 
 #include "threads/thread.h"
+#include "filesys/off_t.h"
+
+struct page;
+
+/* Where a lazily loaded page's contents come from, passed as the
+ * aux of its initializer. */
+struct lazy_load_arg
+{
+	struct file *file;
+	off_t ofs;
+	uint32_t read_bytes;
+	uint32_t zero_bytes;
+};
 
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
+tid_t process_spawn (char *cmd_line);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
@@ -0,0 +1,25 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel access to user memory.
+ *
+ * These functions do not check whether the user pages are mapped
+ * before touching them.  Each access that may fault is recorded in
+ * the exception table; if the page fault handler cannot resolve a
+ * fault raised by one of them, it resumes execution at the matching
+ * fixup address instead of treating the fault as a kernel bug. */
+
+size_t copy_from_user (void *dst, const void *usrc, size_t size);
+size_t copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+
+bool user_range_pin (const void *ubuf, size_t size, bool write);
+void user_range_unpin (const void *ubuf, size_t size, bool written);
+
+uintptr_t uaccess_fixup (uintptr_t rip);
+
+#endif /* userprog/uaccess.h */
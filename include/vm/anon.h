@@ -2,12 +2,24 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 struct page;
+struct slot;
+struct zswap_entry;
 enum vm_type;
 
 struct anon_page {
+	struct slot *slot;      /* Swap slot holding a copy, or NULL. */
+	struct zswap_entry *zswap;  /* Compressed copy in memory, or NULL. */
+	bool readahead;         /* Read ahead from swap, not yet used. */
 };
 
+/* Most pages read by one swap-in; see the -swap-ra option. */
+#define SWAP_READAHEAD_MAX 32
+extern unsigned int swap_readahead_pages;
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void swap_out_cluster (struct page **pages, size_t cnt);
+bool swap_claim_readahead (struct page *page);
+void swap_print_stats (void);
 
 #endif
@@ -0,0 +1,20 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+#include <stdbool.h>
+
+struct page;
+struct share_entry;
+
+/* A read-only executable page whose frame is shared by every
+ * process that maps the same page of the same file. */
+struct share_page {
+	struct share_entry *entry;
+};
+
+void vm_share_init (void);
+bool share_claim_page (struct page *page);
+bool share_is_cached (struct page *page);
+bool share_copy_page (struct page *src);
+void share_print_stats (void);
+
+#endif
@@ -25,15 +25,21 @@ enum vm_type {
 	VM_MARKER_END = (1 << 31),
 };
 
+/* Marks a read-only executable page that may share its frame with
+ * other processes running the same file; see vm/share.c. */
+#define VM_SHARED VM_MARKER_1
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/share.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
 
 struct page_operations;
 struct thread;
+struct vmstat;
 
 #define VM_TYPE(type) ((type) & 7)
 
@@ -48,7 +54,9 @@ struct page {
 
 	/* Your implementation */
 	struct hash_elem hash_elem; 
+	struct thread *owner;  /* Process whose page table maps VA. */
 	bool writable;
+	bool evicting;         /* Being written out by vm_evict_frame(). */
 	int page_count;
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -56,23 +64,22 @@ struct page {
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
+		struct share_page share;
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
 	};
 };
 struct list swap_table;
-struct list frame_table;
 
 struct lock swap_table_lock;
-struct lock frame_table_lock;
-struct lock lazy_load_lock;
 
-/* The representation of "frame" */
+/* The representation of "frame".  There is one for each page of the
+ * user pool, whether in use or not; see vm/vm.c. */
 struct frame {
 	void *kva;
-	struct page *page;
-	struct list_elem frame_elem;
+	struct page *page;      /* Page held, or NULL if none may be evicted. */
+	bool pinned;            /* Never chosen for eviction while true. */
 };
 
 struct slot {
@@ -115,6 +122,8 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
+extern bool vm_exit_stats;
+
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
@@ -124,7 +133,21 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+struct frame *vm_get_frame (enum palloc_flags flags);
+struct frame *vm_install_frame (struct page *page, void *kva, bool pinned);
+void vm_free_frame (struct frame *frame);
+struct frame *vm_take_frame (struct page *page);
 bool vm_claim_page (void *va);
+size_t vm_populate (void *upage, size_t cnt);
+void vm_print_stats (void);
+void vm_get_stat (struct vmstat *stat);
+void vm_print_exit_stats (void);
+void *vm_pin_page (void *upage, bool write);
+void vm_unpin_page (void *upage);
+bool vm_pin_range (const void *uaddr, size_t size, bool write);
+void vm_unpin_range (const void *uaddr, size_t size);
+bool vm_page_is_dirty (struct page *page);
+void vm_page_clear_dirty (struct page *page);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
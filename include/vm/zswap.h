@@ -0,0 +1,17 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stddef.h>
+
+struct zswap_entry;
+
+/* Compressed bytes the pool may hold, in pages; 0 disables it.  Set
+ * with the -zswap option. */
+extern size_t zswap_pool_pages;
+
+void vm_zswap_init (void);
+struct zswap_entry *zswap_store (const void *kva);
+void zswap_load (struct zswap_entry *entry, void *kva);
+void zswap_free (struct zswap_entry *entry);
+void zswap_print_stats (long long disk_swap_in_cnt);
+
+#endif
@@ -138,12 +138,15 @@ puts (const char *s) {
 	return 0;
 }
 
-/* Writes the N characters in BUFFER to the console. */
+/* Writes the N characters in BUFFER to the console, taking the
+   console lock once and handing the whole buffer to each
+   device. */
 void
 putbuf (const char *buffer, size_t n) {
 	acquire_console ();
-	while (n-- > 0)
-		putchar_have_lock (*buffer++);
+	write_cnt += n;
+	serial_putbuf (buffer, n);
+	vga_putbuf (buffer, n);
 	release_console ();
 }
 
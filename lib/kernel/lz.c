@@ -0,0 +1,178 @@
+#include "lz.h"
+#include <debug.h>
+#include <string.h>
+
+/* The compressed form is a series of sequences.  Each sequence is a
+   token byte, whose high 4 bits are a literal count and whose low 4
+   bits are a match length minus LZ_MIN_MATCH, then any extra
+   literal count bytes, the literals, a 2-byte little-endian offset
+   back to the start of the match, and any extra match length bytes.
+   A count of 15 continues in the bytes that follow, which are added
+   to it up to and including the first byte that is not 255.  The
+   last sequence ends after its literals and has no match. */
+
+/* Shortest match worth encoding. */
+#define LZ_MIN_MATCH 4
+
+/* Farthest a match may be from the bytes it repeats. */
+#define LZ_MAX_OFFSET 65535
+
+static uint32_t
+read32 (const uint8_t *p) {
+	uint32_t x;
+	memcpy (&x, p, sizeof x);
+	return x;
+}
+
+static unsigned
+hash32 (uint32_t x) {
+	return (x * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Returns the bytes that a count of N takes beyond its nibble. */
+static size_t
+count_extra (size_t n) {
+	return n < 15 ? 0 : (n - 15) / 255 + 1;
+}
+
+/* Stores the part of count N that does not fit its nibble at *OP
+   and returns the position after it. */
+static uint8_t *
+put_count (uint8_t *op, size_t n) {
+	if (n < 15)
+		return op;
+	for (n -= 15; n >= 255; n -= 255)
+		*op++ = 255;
+	*op++ = n;
+	return op;
+}
+
+/* Adds the extension bytes of a count, starting at *IP and ending
+   before END, to *N.  Returns false if they run past END. */
+static bool
+get_count (const uint8_t **ip, const uint8_t *end, size_t *n) {
+	uint8_t b;
+
+	if (*n < 15)
+		return true;
+	do {
+		if (*ip >= end)
+			return false;
+		b = *(*ip)++;
+		*n += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Appends one sequence, the LIT_CNT literals at LIT and then, if
+   MATCH_LEN is nonzero, a match of MATCH_LEN bytes OFFSET bytes back,
+   at *OP, which must stay before END.  Returns false if it does not
+   fit. */
+static bool
+put_sequence (uint8_t **op, uint8_t *end, const uint8_t *lit,
+		size_t lit_cnt, size_t offset, size_t match_len) {
+	size_t need = 1 + count_extra (lit_cnt) + lit_cnt;
+	size_t match_cnt = match_len ? match_len - LZ_MIN_MATCH : 0;
+	uint8_t *p = *op;
+
+	if (match_len)
+		need += 2 + count_extra (match_cnt);
+	if (need > (size_t) (end - p))
+		return false;
+
+	*p++ = (lit_cnt < 15 ? lit_cnt : 15) << 4
+		| (match_cnt < 15 ? match_cnt : 15);
+	p = put_count (p, lit_cnt);
+	memcpy (p, lit, lit_cnt);
+	p += lit_cnt;
+	if (match_len) {
+		*p++ = offset & 0xff;
+		*p++ = offset >> 8;
+		p = put_count (p, match_cnt);
+	}
+	*op = p;
+	return true;
+}
+
+/* Compresses the SRC_SIZE bytes at SRC into the DST_SIZE bytes at
+   DST, using TABLE as scratch space.  Returns the compressed size,
+   or 0 if it would not fit in DST_SIZE bytes. */
+size_t
+lz_compress (const void *src_, size_t src_size,
+		void *dst_, size_t dst_size, uint16_t table[LZ_TABLE_SIZE]) {
+	const uint8_t *src = src_;
+	uint8_t *op = dst_, *end = op + dst_size;
+	size_t ip = 0, anchor = 0;
+
+	ASSERT (src_size <= LZ_MAX_INPUT);
+
+	/* TABLE holds 1 + the last position with each hash, so that 0
+	   means none. */
+	memset (table, 0, LZ_TABLE_SIZE * sizeof *table);
+	while (ip + LZ_MIN_MATCH <= src_size) {
+		uint32_t seq = read32 (src + ip);
+		unsigned h = hash32 (seq);
+		size_t ref = table[h];
+
+		table[h] = ip + 1;
+		if (ref == 0 || ip - (ref - 1) > LZ_MAX_OFFSET
+				|| read32 (src + ref - 1) != seq) {
+			ip++;
+			continue;
+		}
+
+		size_t match = ref - 1, len = LZ_MIN_MATCH;
+		while (ip + len < src_size && src[match + len] == src[ip + len])
+			len++;
+		if (!put_sequence (&op, end, src + anchor, ip - anchor,
+					ip - match, len))
+			return 0;
+		ip += len;
+		anchor = ip;
+	}
+	if (!put_sequence (&op, end, src + anchor, src_size - anchor, 0, 0))
+		return 0;
+	return op - (uint8_t *) dst_;
+}
+
+/* Decompresses the SRC_SIZE bytes at SRC, produced by
+   lz_compress(), into the DST_SIZE bytes at DST.  Returns true if
+   they decompress to exactly DST_SIZE bytes, false if they are
+   malformed. */
+bool
+lz_decompress (const void *src_, size_t src_size,
+		void *dst_, size_t dst_size) {
+	const uint8_t *ip = src_, *end = ip + src_size;
+	uint8_t *dst = dst_;
+	size_t op = 0;
+
+	while (ip < end) {
+		uint8_t token = *ip++;
+		size_t lit_cnt = token >> 4;
+		size_t offset, len;
+
+		if (!get_count (&ip, end, &lit_cnt)
+				|| lit_cnt > (size_t) (end - ip) || lit_cnt > dst_size - op)
+			return false;
+		memcpy (dst + op, ip, lit_cnt);
+		ip += lit_cnt;
+		op += lit_cnt;
+		if (ip == end)
+			break;
+
+		if (end - ip < 2)
+			return false;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		len = token & 15;
+		if (!get_count (&ip, end, &len))
+			return false;
+		len += LZ_MIN_MATCH;
+		if (offset == 0 || offset > op || len > dst_size - op)
+			return false;
+		/* Byte by byte: a match may overlap the bytes it produces. */
+		for (; len > 0; len--, op++)
+			dst[op] = dst[op - offset];
+	}
+	return op == dst_size;
+}
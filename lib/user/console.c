@@ -3,6 +3,71 @@
 #include <syscall.h>
 #include <syscall-nr.h>
 
+/* Standard output is buffered in the process, so that printf(),
+   puts() and putchar() cost one system call per line (or per
+   buffer) instead of one per call or per character.  It is line
+   buffered by default, since it is the console, and is flushed
+   by exit(), before fork() and exec(), before reads from the
+   keyboard, and before direct write()s to standard output so
+   that output stays in order. */
+static char stdout_buf[512];
+static size_t stdout_len;
+static int stdout_mode = _IOLBF;
+
+static void stdout_putc (char);
+static void stdout_puts (const char *, size_t);
+static void stdout_done (bool newline);
+
+/* Sets the buffering MODE of standard output to one of _IONBF,
+   _IOLBF or _IOFBF, flushing anything already buffered. */
+void
+stdout_setbuf (int mode) {
+	stdout_flush ();
+	stdout_mode = mode;
+}
+
+/* Writes out anything buffered for standard output. */
+void
+stdout_flush (void) {
+	size_t len = stdout_len;
+
+	/* Empty the buffer first: write() flushes it too. */
+	stdout_len = 0;
+	if (len > 0)
+		write (STDOUT_FILENO, stdout_buf, len);
+}
+
+/* Appends C to the standard output buffer, flushing it if it is
+   full. */
+static void
+stdout_putc (char c) {
+	if (stdout_len >= sizeof stdout_buf)
+		stdout_flush ();
+	stdout_buf[stdout_len++] = c;
+}
+
+/* Appends the N bytes in S to the standard output buffer.
+   Strings too big for the buffer are written directly. */
+static void
+stdout_puts (const char *s, size_t n) {
+	if (stdout_len + n > sizeof stdout_buf)
+		stdout_flush ();
+	if (n > sizeof stdout_buf)
+		write (STDOUT_FILENO, s, n);
+	else {
+		memcpy (stdout_buf + stdout_len, s, n);
+		stdout_len += n;
+	}
+}
+
+/* Called at the end of each output call; NEWLINE says whether it
+   wrote a new-line.  Flushes according to the buffering mode. */
+static void
+stdout_done (bool newline) {
+	if (stdout_mode == _IONBF || (stdout_mode == _IOLBF && newline))
+		stdout_flush ();
+}
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list. */
 int
@@ -27,8 +92,9 @@ hprintf (int handle, const char *format, ...) {
    character. */
 int
 puts (const char *s) {
-	write (STDOUT_FILENO, s, strlen (s));
-	putchar ('\n');
+	stdout_puts (s, strlen (s));
+	stdout_putc ('\n');
+	stdout_done (true);
 
 	return 0;
 }
@@ -36,8 +102,8 @@ puts (const char *s) {
 /* Writes C to the console. */
 int
 putchar (int c) {
-	char c2 = c;
-	write (STDOUT_FILENO, &c2, 1);
+	stdout_putc (c);
+	stdout_done (c == '\n');
 	return c;
 }
 
@@ -47,6 +113,7 @@ struct vhprintf_aux {
 	char *p;            /* Current position in buffer. */
 	int char_cnt;       /* Total characters written so far. */
 	int handle;         /* Output file handle. */
+	bool newline;       /* Wrote a new-line? */
 };
 
 static void add_char (char, void *);
@@ -61,20 +128,28 @@ vhprintf (int handle, const char *format, va_list args) {
 	aux.p = aux.buf;
 	aux.char_cnt = 0;
 	aux.handle = handle;
+	aux.newline = false;
 	__vprintf (format, args, add_char, &aux);
 	flush (&aux);
+	if (handle == STDOUT_FILENO)
+		stdout_done (aux.newline);
 	return aux.char_cnt;
 }
 
 /* Adds C to the buffer in AUX, flushing it if the buffer fills
-   up. */
+   up.  Output to standard output goes straight to its buffer. */
 static void
 add_char (char c, void *aux_) {
 	struct vhprintf_aux *aux = aux_;
+	aux->char_cnt++;
+	if (aux->handle == STDOUT_FILENO) {
+		stdout_putc (c);
+		aux->newline |= c == '\n';
+		return;
+	}
 	*aux->p++ = c;
 	if (aux->p >= aux->buf + sizeof aux->buf)
 		flush (aux);
-	aux->char_cnt++;
 }
 
 /* Flushes the buffer in AUX. */
@@ -1,5 +1,6 @@
 #include <syscall.h>
 #include <stdint.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
 __attribute__((always_inline))
@@ -54,7 +55,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -78,6 +79,7 @@ halt (void) {
 
 void
 exit (int status) {
+	stdout_flush ();
 	syscall1 (SYS_EXIT, status);
 	/*use thread_exit() print message "name of process: exit(status)"*/
 	NOT_REACHED ();
@@ -85,6 +87,7 @@ exit (int status) {
 
 pid_t
 fork (const char *thread_name){
+	stdout_flush ();
 	return (pid_t) syscall1 (SYS_FORK, thread_name);
 }
 
@@ -92,9 +95,16 @@ int
 exec (const char *file) {
 	/* create child process and execute program corresponds to cmd_line on it.
 	NOTICE! not similar in exec in UNIX exec in Pintos similar with combination of frok() and exec()*/
+	stdout_flush ();
 	return (pid_t) syscall1 (SYS_EXEC, file);
 }
 
+pid_t
+spawn (const char *cmd_line) {
+	stdout_flush ();
+	return (pid_t) syscall1 (SYS_SPAWN, cmd_line);
+}
+
 int
 wait (pid_t pid) {  
 	 /*wait for aachild process pid to exit and retirve the child's exit status.
@@ -127,11 +137,15 @@ filesize (int fd) {
 
 int
 read (int fd, void *buffer, unsigned size) {
+	if (fd == STDIN_FILENO)
+		stdout_flush ();
 	return syscall3 (SYS_READ, fd, buffer, size);
 }
 
 int
 write (int fd, const void *buffer, unsigned size) {
+	if (fd == STDOUT_FILENO)
+		stdout_flush ();
 	return syscall3 (SYS_WRITE, fd, buffer, size);
 }
 
@@ -155,6 +169,26 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
@@ -165,6 +199,11 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+vmstat (struct vmstat *stat) {
+	return syscall1 (SYS_VMSTAT, stat);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -0,0 +1,45 @@
+/* Fills the root directory with up to 10,000 empty files, then
+   measures the cost of opening each of them by name.  Name
+   lookups dominate, so this compares directory lookup
+   strategies. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 10000
+
+void
+test_main (void)
+{
+  char name[16];
+  uint64_t start;
+  int created, i;
+
+  for (created = 0; created < FILE_CNT; created++)
+    {
+      snprintf (name, sizeof name, "f%d", created);
+      if (!create (name, 0))
+        break;
+    }
+  CHECK (created > 0, "create files");
+
+  start = rdtsc ();
+  for (i = 0; i < created; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "f%d", i);
+      fd = open (name);
+      if (fd < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  msg ("%d files: %llu cycles per open", created,
+       (unsigned long long) ((rdtsc () - start) / created));
+
+  if (open ("f-missing") != -1)
+    fail ("opened nonexistent file");
+  msg ("PASS");
+}
@@ -0,0 +1,138 @@
+/* Checks memcpy(), memset(), memcmp() and strlen() against
+   straightforward byte-at-a-time versions at every small
+   alignment, then reports the throughput of both for 16 B,
+   512 B and 4 kB operations. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "intrinsic.h"
+
+#define ITERATIONS 256
+
+static void *
+byte_memcpy (void *dst_, const void *src_, size_t size) 
+{
+  unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+static void *
+byte_memset (void *dst_, int value, size_t size) 
+{
+  unsigned char *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+static void check_correctness (uint8_t *, uint8_t *, uint8_t *);
+static void measure (const char *, uint8_t *, uint8_t *, size_t);
+
+void
+test_string_speed (void) 
+{
+  uint8_t *src = palloc_get_page (PAL_ASSERT);
+  uint8_t *dst = palloc_get_page (PAL_ASSERT);
+  uint8_t *ref = palloc_get_page (PAL_ASSERT);
+
+  check_correctness (src, dst, ref);
+
+  measure ("16 B", dst, src, 16);
+  measure ("512 B", dst, src, 512);
+  measure ("4 kB", dst, src, PGSIZE);
+
+  palloc_free_page (src);
+  palloc_free_page (dst);
+  palloc_free_page (ref);
+  pass ();
+}
+
+static void
+check_correctness (uint8_t *src, uint8_t *dst, uint8_t *ref) 
+{
+  size_t s_ofs, d_ofs, size, i;
+
+  for (i = 0; i < PGSIZE; i++)
+    src[i] = i * 7 + 1;
+
+  for (s_ofs = 0; s_ofs < 8; s_ofs++)
+    for (d_ofs = 0; d_ofs < 8; d_ofs++)
+      for (size = 0; size < 300; size += size < 80 ? 1 : 37) 
+        {
+          byte_memset (dst, 0xa5, 512);
+          byte_memset (ref, 0xa5, 512);
+          memcpy (dst + d_ofs, src + s_ofs, size);
+          byte_memcpy (ref + d_ofs, src + s_ofs, size);
+          for (i = 0; i < 512; i++)
+            if (dst[i] != ref[i])
+              fail ("memcpy mismatch: src+%zu dst+%zu size %zu",
+                    s_ofs, d_ofs, size);
+
+          memset (dst + d_ofs, (int) s_ofs, size);
+          byte_memset (ref + d_ofs, (int) s_ofs, size);
+          for (i = 0; i < 512; i++)
+            if (dst[i] != ref[i])
+              fail ("memset mismatch: dst+%zu size %zu", d_ofs, size);
+
+          if (size > 0)
+            {
+              byte_memcpy (dst, src, 512);
+              dst[s_ofs + size - 1]++;
+              if (memcmp (src + s_ofs, dst + s_ofs, size) >= 0)
+                fail ("memcmp missed difference: ofs %zu size %zu",
+                      s_ofs, size);
+              dst[s_ofs + size - 1]--;
+              if (memcmp (src + s_ofs, dst + s_ofs, size) != 0)
+                fail ("memcmp reported difference: ofs %zu size %zu",
+                      s_ofs, size);
+            }
+
+          byte_memset (dst, 'x', 512);
+          dst[d_ofs + size] = '\0';
+          if (strlen ((char *) dst + d_ofs) != size)
+            fail ("strlen wrong: ofs %zu length %zu", d_ofs, size);
+        }
+}
+
+/* Prints bytes copied per 100 cycles, old versus new. */
+static void
+measure (const char *name, uint8_t *dst, uint8_t *src, size_t size) 
+{
+  uint64_t start, byte_cycles, fast_cycles;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    byte_memcpy (dst, src, size);
+  byte_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    memcpy (dst, src, size);
+  fast_cycles = rdtsc () - start;
+
+  msg ("memcpy %s: %llu -> %llu bytes per 100 cycles", name,
+       (unsigned long long) (size * ITERATIONS * 100 / (byte_cycles + 1)),
+       (unsigned long long) (size * ITERATIONS * 100 / (fast_cycles + 1)));
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    byte_memset (dst, i, size);
+  byte_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    memset (dst, i, size);
+  fast_cycles = rdtsc () - start;
+
+  msg ("memset %s: %llu -> %llu bytes per 100 cycles", name,
+       (unsigned long long) (size * ITERATIONS * 100 / (byte_cycles + 1)),
+       (unsigned long long) (size * ITERATIONS * 100 / (fast_cycles + 1)));
+}
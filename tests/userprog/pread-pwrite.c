@@ -0,0 +1,41 @@
+/* Writes and reads a file with pwrite() and pread() at explicit
+   offsets, checking that the data lands where asked and that the
+   file position is not moved, then reads it back with readv()
+   into several buffers. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char head[6], tail[6], all[12];
+  struct iovec iov[2];
+  int fd;
+
+  CHECK (create ("pfile", 12), "create \"pfile\"");
+  CHECK ((fd = open ("pfile")) > 1, "open \"pfile\"");
+
+  CHECK (pwrite (fd, "world!", 6, 6) == 6, "pwrite at offset 6");
+  CHECK (pwrite (fd, "hello ", 6, 0) == 6, "pwrite at offset 0");
+  CHECK (tell (fd) == 0, "file position unchanged");
+
+  CHECK (pread (fd, tail, 6, 6) == 6, "pread at offset 6");
+  if (memcmp (tail, "world!", 6))
+    fail ("pread returned wrong data");
+  CHECK (pread (fd, all, sizeof all, 10) == 2, "pread past end is short");
+
+  iov[0].iov_base = head;
+  iov[0].iov_len = sizeof head;
+  iov[1].iov_base = tail;
+  iov[1].iov_len = sizeof tail;
+  CHECK (readv (fd, iov, 2) == 12, "readv into 2 buffers");
+  if (memcmp (head, "hello ", 6) || memcmp (tail, "world!", 6))
+    fail ("readv returned wrong data");
+  CHECK (tell (fd) == 12, "readv advanced file position");
+
+  msg ("close \"pfile\"");
+  close (fd);
+}
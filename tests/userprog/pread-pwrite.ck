@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "pfile"
+(pread-pwrite) open "pfile"
+(pread-pwrite) pwrite at offset 6
+(pread-pwrite) pwrite at offset 0
+(pread-pwrite) file position unchanged
+(pread-pwrite) pread at offset 6
+(pread-pwrite) pread past end is short
+(pread-pwrite) readv into 2 buffers
+(pread-pwrite) readv advanced file position
+(pread-pwrite) close "pfile"
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* Measures process creation: starting child-simple with fork()
+   followed by exec() in the child, against starting it with a
+   single spawn(), which does not copy the parent's address
+   space.  Successful steps print nothing, so that the output does
+   not depend on whether parent or child runs first. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITERATIONS 10
+
+/* Touched so that fork() has some memory to copy. */
+static char ballast[64 * 1024];
+
+void
+test_main (void)
+{
+  uint64_t start, fork_cycles, spawn_cycles;
+  size_t i;
+  int n;
+
+  for (i = 0; i < sizeof ballast; i += 4096)
+    ballast[i] = 1;
+
+  start = rdtsc ();
+  for (n = 0; n < ITERATIONS; n++)
+    {
+      pid_t pid = fork ("child-simple");
+      if (pid == 0)
+        {
+          exec ("child-simple");
+          fail ("exec failed");
+        }
+      if (pid < 0)
+        fail ("fork failed");
+      if (wait (pid) != 81)
+        fail ("child-simple did not exit(81)");
+    }
+  fork_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (n = 0; n < ITERATIONS; n++)
+    {
+      pid_t pid = spawn ("child-simple");
+      if (pid == PID_ERROR)
+        fail ("spawn failed");
+      if (wait (pid) != 81)
+        fail ("child-simple did not exit(81)");
+    }
+  spawn_cycles = rdtsc () - start;
+
+  if (spawn ("no-such-file") != PID_ERROR)
+    fail ("spawned a missing program");
+
+  msg ("fork+exec: %llu cycles per child",
+       (unsigned long long) (fork_cycles / ITERATIONS));
+  msg ("spawn: %llu cycles per child",
+       (unsigned long long) (spawn_cycles / ITERATIONS));
+  msg ("PASS");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Cycle counts vary from run to run; the rest must match.  The
+# failed spawn's exit may print before or after the parent goes on.
+s/\d+ cycles per child$/N cycles per child/ foreach @output;
+my ($children) = "(child-simple) run\n" x 20;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<EOF]);
+(spawn-speed) begin
+${children}load: no-such-file: open failed
+(spawn-speed) fork+exec: N cycles per child
+(spawn-speed) spawn: N cycles per child
+(spawn-speed) PASS
+(spawn-speed) end
+EOF
+pass;
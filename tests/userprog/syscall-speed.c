@@ -0,0 +1,73 @@
+/* Measures the latency of system calls that take user pointers:
+   open/close of a named file, and 16-byte and 4 kB reads and
+   writes.  Run against kernels with different user-memory access
+   strategies to compare them. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITERATIONS 200
+
+static char buf[4096];
+
+/* Prints the average cycles per call of the last ITERATIONS calls,
+   given the time-stamp counter value before them. */
+static void
+report (const char *what, uint64_t start)
+{
+  uint64_t cycles = rdtsc () - start;
+  msg ("%s: %llu cycles per call", what,
+       (unsigned long long) (cycles / ITERATIONS));
+}
+
+void
+test_main (void)
+{
+  uint64_t start;
+  int fd, i;
+
+  CHECK (create ("bench", sizeof buf), "create \"bench\"");
+  CHECK ((fd = open ("bench")) > 1, "open \"bench\"");
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    close (open ("bench"));
+  report ("open+close", start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      seek (fd, 0);
+      write (fd, buf, 16);
+    }
+  report ("write 16 B", start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      seek (fd, 0);
+      write (fd, buf, sizeof buf);
+    }
+  report ("write 4 kB", start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      seek (fd, 0);
+      read (fd, buf, 16);
+    }
+  report ("read 16 B", start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      seek (fd, 0);
+      if (read (fd, buf, sizeof buf) != (int) sizeof buf)
+        fail ("short read");
+    }
+  report ("read 4 kB", start);
+
+  close (fd);
+  msg ("PASS");
+}
@@ -0,0 +1,55 @@
+/* Writes a file made of many small records, first with one
+   write() per record and then with a single writev() that
+   gathers them all, verifies both, and reports the system calls
+   and cycles each approach took. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RECORD_CNT 256
+#define RECORD_SIZE 16
+
+static char records[RECORD_CNT][RECORD_SIZE];
+static struct iovec iov[RECORD_CNT];
+
+void
+test_main (void)
+{
+  uint64_t start, cycles;
+  int fd, i, j;
+
+  for (i = 0; i < RECORD_CNT; i++)
+    for (j = 0; j < RECORD_SIZE; j++)
+      records[i][j] = 'a' + (i + j) % 26;
+
+  CHECK (create ("gather", sizeof records), "create \"gather\"");
+  CHECK ((fd = open ("gather")) > 1, "open \"gather\"");
+  start = rdtsc ();
+  for (i = 0; i < RECORD_CNT; i++)
+    if (write (fd, records[i], RECORD_SIZE) != RECORD_SIZE)
+      fail ("write of record %d failed", i);
+  cycles = rdtsc () - start;
+  close (fd);
+  check_file ("gather", records, sizeof records);
+  msg ("write: %d system calls, %llu cycles", RECORD_CNT,
+       (unsigned long long) cycles);
+
+  for (i = 0; i < RECORD_CNT; i++)
+    {
+      iov[i].iov_base = records[i];
+      iov[i].iov_len = RECORD_SIZE;
+    }
+  CHECK (remove ("gather"), "remove \"gather\"");
+  CHECK (create ("gather", sizeof records), "create \"gather\"");
+  CHECK ((fd = open ("gather")) > 1, "open \"gather\"");
+  start = rdtsc ();
+  if (writev (fd, iov, RECORD_CNT) != (int) sizeof records)
+    fail ("writev failed");
+  cycles = rdtsc () - start;
+  close (fd);
+  check_file ("gather", records, sizeof records);
+  msg ("writev: 1 system call, %llu cycles", (unsigned long long) cycles);
+
+  msg ("PASS");
+}
@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Cycle counts vary from run to run; the rest must match.
+s/\d+ cycles$/N cycles/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(writev-gather) begin
+(writev-gather) create "gather"
+(writev-gather) open "gather"
+(writev-gather) open "gather" for verification
+(writev-gather) verified contents of "gather"
+(writev-gather) close "gather"
+(writev-gather) write: 256 system calls, N cycles
+(writev-gather) remove "gather"
+(writev-gather) create "gather"
+(writev-gather) open "gather"
+(writev-gather) open "gather" for verification
+(writev-gather) verified contents of "gather"
+(writev-gather) close "gather"
+(writev-gather) writev: 1 system call, N cycles
+(writev-gather) PASS
+(writev-gather) end
+writev-gather: exit(0)
+EOF
+pass;
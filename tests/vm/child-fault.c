@@ -0,0 +1,33 @@
+/* Child process of page-fault-par.
+   Touches every page of a large initialized data array, each of
+   which is read in from the executable on its first access, and
+   reports the cost per fault. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-fault";
+
+#define PAGE_CNT 128
+#define SIZE (PAGE_CNT * 4096)
+
+/* Nonzero, so that it is in the file rather than the bss. */
+static char data[SIZE] = { 1 };
+
+int
+main (void)
+{
+  uint64_t start;
+  size_t i;
+  int sum = 0;
+
+  start = rdtsc ();
+  for (i = 0; i < SIZE; i += 4096)
+    sum += data[i];
+  msg ("%llu cycles per fault",
+       (unsigned long long) ((rdtsc () - start) / PAGE_CNT));
+
+  if (sum != 1)
+    fail ("bad data");
+  return 0x42;
+}
@@ -0,0 +1,53 @@
+/* Maps the same part of a file twice, once faulting in pages
+   on demand and once with MAP_POPULATE, and reports how long it
+   takes to touch every page of each mapping. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 256
+#define LAZY ((char *) 0x10000000)
+#define POPULATED ((char *) 0x20000000)
+
+static uint64_t
+touch_pages (const char *map)
+{
+  uint64_t start = rdtsc ();
+  volatile char c;
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    c = map[i * 4096];
+  (void) c;
+  return rdtsc () - start;
+}
+
+void
+test_main (void)
+{
+  size_t size = PAGE_CNT * 4096;
+  int lazy_fd, populated_fd;
+  uint64_t lazy_cycles, populated_cycles;
+
+  CHECK ((lazy_fd = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((populated_fd = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK (mmap (LAZY, size, 2, lazy_fd, 0) == MAP_FAILED,
+         "mmap with an unknown flag must fail");
+  CHECK (mmap (LAZY, size, 0, lazy_fd, 0) != MAP_FAILED,
+         "mmap \"large.txt\"");
+  CHECK (mmap (POPULATED, size, MAP_POPULATE, populated_fd, 0)
+         != MAP_FAILED, "mmap \"large.txt\" with MAP_POPULATE");
+
+  lazy_cycles = touch_pages (LAZY);
+  populated_cycles = touch_pages (POPULATED);
+  if (memcmp (LAZY, POPULATED, size))
+    fail ("populated mapping differs from demand-paged mapping");
+
+  msg ("%d pages on demand: %llu cycles", PAGE_CNT,
+       (unsigned long long) lazy_cycles);
+  msg ("%d pages populated: %llu cycles", PAGE_CNT,
+       (unsigned long long) populated_cycles);
+  msg ("PASS");
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Cycle counts vary from run to run; the rest must match.
+s/\d+ cycles$/N cycles/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(mmap-populate) begin
+(mmap-populate) open "large.txt"
+(mmap-populate) open "large.txt"
+(mmap-populate) mmap with an unknown flag must fail
+(mmap-populate) mmap "large.txt"
+(mmap-populate) mmap "large.txt" with MAP_POPULATE
+(mmap-populate) 256 pages on demand: N cycles
+(mmap-populate) 256 pages populated: N cycles
+(mmap-populate) PASS
+(mmap-populate) end
+mmap-populate: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Runs 4 child-fault processes at once, so that their page
+   faults, which all read the same executable, overlap. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK ((children[i] = spawn ("child-fault")) != PID_ERROR,
+           "spawn child %d", i);
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (children[i]) != 0x42)
+      fail ("child %d failed", i);
+  msg ("%d children: %llu cycles", CHILD_CNT,
+       (unsigned long long) (rdtsc () - start));
+  msg ("PASS");
+}
@@ -0,0 +1,57 @@
+/* Touches every page of a 4 MB bss array, which contains at least
+   one 2 MB-aligned region, then measures the cost of reading one
+   byte per page across it, a pattern dominated by TLB misses.
+   Reports whether the aligned region ended up physically
+   contiguous, as it is when backed by a 2 MB page. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HUGE_SIZE (2 * 1024 * 1024)
+#define SIZE (2 * HUGE_SIZE)
+#define PASSES 16
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  char *region = (char *) (((uintptr_t) buf + HUGE_SIZE - 1)
+                           & ~(uintptr_t) (HUGE_SIZE - 1));
+  uintptr_t first_pa;
+  bool contiguous = true;
+  uint64_t start, cycles;
+  unsigned sum = 0;
+  size_t i;
+  int pass;
+
+  msg ("initialize");
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    buf[i] = i / PAGE_SIZE;
+
+  first_pa = (uintptr_t) get_phys_addr (region);
+  for (i = 0; i < HUGE_SIZE; i += PAGE_SIZE)
+    if ((uintptr_t) get_phys_addr (region + i) != first_pa + i)
+      contiguous = false;
+  msg ("aligned region %s physically contiguous",
+       contiguous ? "is" : "is not");
+
+  start = rdtsc ();
+  for (pass = 0; pass < PASSES; pass++)
+    for (i = 0; i < SIZE; i += PAGE_SIZE)
+      sum += (unsigned char) buf[i];
+  cycles = rdtsc () - start;
+  msg ("strided read: %llu cycles per page",
+       (unsigned long long) (cycles / (PASSES * (SIZE / PAGE_SIZE))));
+
+  msg ("verify");
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    if (buf[i] != (char) (i / PAGE_SIZE))
+      fail ("page %zu has wrong contents", i / PAGE_SIZE);
+  if (sum == 0)
+    fail ("strided read saw only zeros");
+  msg ("PASS");
+}
@@ -0,0 +1,45 @@
+/* Checks that vmstat() counts the faults this process takes: zero
+   pages touched for the first time are minor faults, pages of a
+   file mapping are major faults, and both stay resident. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ZERO_PAGES 64
+#define FILE_PAGES 16
+#define MAP ((char *) 0x10000000)
+
+static char zeros[ZERO_PAGES * 4096];
+
+void
+test_main (void)
+{
+  struct vmstat before, after;
+  volatile char c;
+  int fd;
+  size_t i;
+
+  CHECK ((fd = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK (mmap (MAP, FILE_PAGES * 4096, 0, fd, 0) != MAP_FAILED,
+         "mmap \"large.txt\"");
+  CHECK (vmstat (&before) == 0, "vmstat");
+
+  for (i = 0; i < ZERO_PAGES; i++)
+    zeros[i * 4096] = 1;
+  for (i = 0; i < FILE_PAGES; i++)
+    c = MAP[i * 4096];
+  (void) c;
+
+  CHECK (vmstat (&after) == 0, "vmstat");
+  if (after.minor_faults - before.minor_faults < ZERO_PAGES - 1)
+    fail ("%lld minor faults for %d zero pages",
+          after.minor_faults - before.minor_faults, ZERO_PAGES);
+  if (after.major_faults - before.major_faults < FILE_PAGES)
+    fail ("%lld major faults for %d file pages",
+          after.major_faults - before.major_faults, FILE_PAGES);
+  if (after.rss - before.rss < ZERO_PAGES - 1 + FILE_PAGES)
+    fail ("resident set grew by %lld pages for %d pages touched",
+          after.rss - before.rss, ZERO_PAGES + FILE_PAGES);
+  msg ("PASS");
+}
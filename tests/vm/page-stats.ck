@@ -0,0 +1,32 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Run with -vmstat, the process reports its counters as it exits.
+# They include faults taken before the test's first vmstat(), so
+# they can only be checked against lower bounds.
+my ($stats) = grep (/^page-stats: vmstat: /, @output);
+fail "missing vmstat line at exit\n" if !defined $stats;
+my ($minor, $major, $rss) = $stats =~ /^page-stats: vmstat: (\d+) minor faults, (\d+) major faults, \d+ swap-ins, \d+ swap-outs, \d+ fork copies, (\d+) pages resident$/
+  or fail "malformed vmstat line: $stats\n";
+fail "$minor minor faults at exit, expected at least 63\n" if $minor < 63;
+fail "$major major faults at exit, expected at least 16\n" if $major < 16;
+fail "$rss pages resident at exit, expected at least 79\n" if $rss < 79;
+
+@output = grep (!/^page-stats: vmstat: /, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(page-stats) begin
+(page-stats) open "large.txt"
+(page-stats) mmap "large.txt"
+(page-stats) vmstat
+(page-stats) vmstat
+(page-stats) PASS
+(page-stats) end
+page-stats: exit(0)
+EOF
+pass;
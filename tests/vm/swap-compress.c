@@ -0,0 +1,41 @@
+/* Swaps out pages that compress well: mostly zeros, with a short
+   run of bytes.  Run with -zswap, most come back from memory
+   instead of the swap disk.  Times two passes over the pages. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (16 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define RUN_SIZE 64
+
+static char big_chunks[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  uint64_t start;
+  size_t i;
+
+  start = rdtsc ();
+  for (i = 0; i < PAGE_COUNT; i++)
+    memset (big_chunks + i * PAGE_SIZE, (char) i, RUN_SIZE);
+  msg ("write %d pages: %llu cycles", PAGE_COUNT,
+       (unsigned long long) (rdtsc () - start));
+
+  start = rdtsc ();
+  for (i = 0; i < PAGE_COUNT; i++)
+    {
+      char *page = big_chunks + i * PAGE_SIZE;
+      if (page[0] != (char) i || page[RUN_SIZE - 1] != (char) i
+          || page[RUN_SIZE] != 0)
+        fail ("page %zu is inconsistent", i);
+    }
+  msg ("check %d pages: %llu cycles", PAGE_COUNT,
+       (unsigned long long) (rdtsc () - start));
+  msg ("PASS");
+}
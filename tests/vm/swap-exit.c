@@ -0,0 +1,57 @@
+/* Forks 8 children that each fill 1 MB of memory, more than fits
+   in memory together, and exit one after another, so that processes
+   exit while others evict their pages and the parent's. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 8
+#define PAGE_SIZE 4096
+#define PAGE_COUNT ((1 << 20) / PAGE_SIZE)
+
+static char big_chunk[PAGE_COUNT * PAGE_SIZE];
+
+/* Writes a byte depending on SEED to every page of big_chunk, PASSES
+   times over, and fails if one does not read back. */
+static void
+fill_and_check (int seed, int passes)
+{
+  size_t i;
+  int pass;
+
+  for (pass = 0; pass < passes; pass++)
+    {
+      for (i = 0; i < PAGE_COUNT; i++)
+        big_chunk[i * PAGE_SIZE] = (char) (i + seed + pass);
+      for (i = 0; i < PAGE_COUNT; i++)
+        if (big_chunk[i * PAGE_SIZE] != (char) (i + seed + pass))
+          fail ("page %zu of process %d is inconsistent", i, seed);
+    }
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  /* The parent touches big_chunk only after forking, so that the
+     children start with none of it resident. */
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      children[i] = fork ("child");
+      if (children[i] == 0)
+        {
+          fill_and_check (i + 1, i + 1);
+          exit (i);
+        }
+      CHECK (children[i] != PID_ERROR, "fork child %d", i);
+    }
+  fill_and_check (0, 4);
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (children[i]) != i)
+      fail ("child %d failed", i);
+  fill_and_check (0, 1);
+  msg ("PASS");
+}
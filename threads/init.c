@@ -31,11 +31,15 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#ifdef EFILESYS
+#include "filesys/fat.h"
+#endif
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -216,6 +220,10 @@ parse_options (char **argv) {
 #ifdef FILESYS
 		else if (!strcmp (name, "-f"))
 			format_filesys = true;
+#ifdef EFILESYS
+		else if (!strcmp (name, "-cluster"))
+			fat_cluster_sectors = atoi (value);
+#endif
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
@@ -226,6 +234,19 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-swap-ra")) {
+			int pages = atoi (value);
+			swap_readahead_pages = pages < 1 ? 1
+				: pages > SWAP_READAHEAD_MAX ? SWAP_READAHEAD_MAX : pages;
+		}
+		else if (!strcmp (name, "-zswap")) {
+			int pages = atoi (value);
+			zswap_pool_pages = pages > 0 ? pages : 0;
+		}
+		else if (!strcmp (name, "-vmstat"))
+			vm_exit_stats = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -324,10 +345,18 @@ usage (void) {
 			"  -h                 Print this help message and power off.\n"
 			"  -q                 Power off VM after actions or on panic.\n"
 			"  -f                 Format file system disk during startup.\n"
+#ifdef EFILESYS
+			"  -cluster=N         Format with N sectors per cluster.\n"
+#endif
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -swap-ra=N         Read up to N pages per swap-in.\n"
+			"  -zswap=N           Keep up to N pages of compressed swap in RAM.\n"
+			"  -vmstat            Print each process's paging counters at exit.\n"
 #endif
 			);
 	power_off ();
@@ -362,4 +391,8 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+	share_print_stats ();
+#endif
 }
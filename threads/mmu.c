@@ -2,17 +2,63 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Page tables set aside for splitting 2 MB mappings: one for each
+ * mapping made by pml4_set_huge_page() and not yet split or
+ * destroyed, so that pde_split() never allocates and cannot fail.
+ * Each is linked to the next through its first word. */
+static void *split_reserve;
+
+/* Adds page table PT to the reserve. */
+static void
+split_reserve_push (void *pt) {
+	enum intr_level old_level = intr_disable ();
+	*(void **) pt = split_reserve;
+	split_reserve = pt;
+	intr_set_level (old_level);
+}
+
+/* Takes a page table from the reserve. */
+static void *
+split_reserve_pop (void) {
+	enum intr_level old_level = intr_disable ();
+	void *pt = split_reserve;
+	ASSERT (pt != NULL);
+	split_reserve = *(void **) pt;
+	intr_set_level (old_level);
+	return pt;
+}
+
+/* Replaces the 2 MB mapping in *PDE by a page table mapping the
+ * same frames with 4 kB pages, so that they can be changed one at a
+ * time. */
+static void
+pde_split (uint64_t *pde, const uint64_t va) {
+	uint64_t *pt = split_reserve_pop ();
+	uint64_t pa = PTE_ADDR (*pde);
+	uint64_t flags = *pde & PTE_FLAGS & ~PTE_PS;
+
+	for (unsigned i = 0; i < HPGCNT; i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	invlpg (va & ~(HPGSIZE - 1));
+}
+
+/* A 2 MB mapping found by a lookup is split into 4 kB pages, so the
+ * returned PTE may always be read and modified on its own. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if (((uint64_t) pte & PTE_P) && ((uint64_t) pte & PTE_PS))
+			pde_split (&pdp[idx], va);
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -88,6 +134,38 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the page-directory entry for VA in PML4.  If CREATE is
+ * true, missing upper-level tables are allocated; otherwise returns
+ * a null pointer when there are none. */
+static uint64_t *
+pde_walk (uint64_t *pml4, const uint64_t va, bool create) {
+	uint64_t *table = pml4;
+	const unsigned idx[] = { PML4 (va), PDPE (va) };
+
+	for (unsigned i = 0; i < 2; i++) {
+		uint64_t *entry = &table[idx[i]];
+		if (!(*entry & PTE_P)) {
+			uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+			if (new_page == NULL)
+				return NULL;
+			*entry = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (*entry));
+	}
+	return &table[PDX (va)];
+}
+
+/* Returns the page-directory entry for VA in PML4 if VA is mapped
+ * by a 2 MB page, otherwise a null pointer.  Lets the read-only
+ * accessors inspect a 2 MB mapping without splitting it. */
+static uint64_t *
+huge_pde (uint64_t *pml4, const void *va) {
+	uint64_t *pde = pde_walk (pml4, (uint64_t) va, false);
+	if (pde != NULL && (*pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS))
+		return pde;
+	return NULL;
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -122,7 +200,7 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((((uint64_t) pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -157,11 +235,16 @@ pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 
 static void
 pt_destroy (uint64_t *pt) {
+#ifndef VM
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pt[i]);
 		if (((uint64_t) pte) & PTE_P)
 			palloc_free_page ((void *) PTE_ADDR (pte));
 	}
+#endif
+	/* With VM, user frames belong to the frame table and are
+	 * released by their page's destroy hook, so the leaf entries
+	 * need not be visited at all. */
 	palloc_free_page ((void *) pt);
 }
 
@@ -169,7 +252,11 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		if (pdp[i] & PTE_PS)
+			palloc_free_page (split_reserve_pop ());
+		else
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -185,7 +272,8 @@ pdpe_destroy (uint64_t *pdpe) {
 	palloc_free_page ((void *) pdpe);
 }
 
-/* Destroys pml4e, freeing all the pages it references. */
+/* Destroys pml4e, freeing all the pages it references.
+ * Under VM, only the paging structures are freed; see pt_destroy. */
 void
 pml4_destroy (uint64_t *pml4) {
 	if (pml4 == NULL)
@@ -214,6 +302,10 @@ void *
 pml4_get_page (uint64_t *pml4, const void *uaddr) {
 	ASSERT (is_user_vaddr (uaddr));
 
+	uint64_t *pde = huge_pde (pml4, uaddr);
+	if (pde != NULL)
+		return ptov (PTE_ADDR (*pde)) + ((uint64_t) uaddr & (HPGSIZE - 1));
+
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
 	if (pte && (*pte & PTE_P))
@@ -243,6 +335,41 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Maps the 2 MB user region at UPAGE with a single page-directory
+ * entry to the physically contiguous frames at KPAGE.  Both must be
+ * 2 MB aligned and no page in the region may be mapped.  Per-page
+ * operations on the region later split it back into 4 kB pages,
+ * with a page table set aside now, so that splitting cannot fail.
+ * Returns false if memory allocation failed. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (((uint64_t) upage & (HPGSIZE - 1)) == 0);
+	ASSERT (((uint64_t) kpage & (HPGSIZE - 1)) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pde_walk (pml4, (uint64_t) upage, true);
+	uint64_t *pt;
+	if (pde == NULL)
+		return false;
+	if (*pde & PTE_P) {
+		/* Reserve the (empty) page table left by earlier mappings. */
+		pt = ptov (PTE_ADDR (*pde));
+		ASSERT (!(*pde & PTE_PS));
+		for (unsigned i = 0; i < HPGCNT; i++)
+			ASSERT (!(pt[i] & PTE_P));
+	} else {
+		pt = palloc_get_page (0);
+		if (pt == NULL)
+			return false;
+	}
+	split_reserve_push (pt);
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	if (rcr3 () == vtop (pml4))
+		invlpg ((uint64_t) upage);
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -268,7 +395,9 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
  * Returns false if PML4 contains no PTE for VPAGE. */
 bool
 pml4_is_dirty (uint64_t *pml4, const void *vpage) {
-	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	uint64_t *pte = huge_pde (pml4, vpage);
+	if (pte == NULL)
+		pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	return pte != NULL && (*pte & PTE_D) != 0;
 }
 
@@ -294,7 +423,9 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
  * PML4 contains no PTE for VPAGE. */
 bool
 pml4_is_accessed (uint64_t *pml4, const void *vpage) {
-	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	uint64_t *pte = huge_pde (pml4, vpage);
+	if (pte == NULL)
+		pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	return pte != NULL && (*pte & PTE_A) != 0;
 }
 
@@ -313,3 +444,155 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 			invlpg ((uint64_t) vpage);
 	}
 }
+
+/* Range operations.
+ *
+ * These walk the upper levels of the page table once per page-table
+ * page (every 2 MB of address space) instead of once per page, and
+ * gather the TLB invalidations they require into a single flush at
+ * the end. */
+
+/* Past this many pages, reloading CR3 beats individual invlpg's. */
+#define TLB_BATCH_MAX 32
+
+struct tlb_batch {
+	uint64_t *pml4;
+	size_t cnt;
+	uint64_t va[TLB_BATCH_MAX];
+};
+
+typedef void pte_range_func (uint64_t *pte, uint64_t va, void *aux);
+
+/* Records that the translation for VA in BATCH must be flushed. */
+static void
+tlb_batch_add (struct tlb_batch *batch, uint64_t va) {
+	if (batch->cnt < TLB_BATCH_MAX)
+		batch->va[batch->cnt] = va;
+	batch->cnt++;
+}
+
+/* Performs the invalidations gathered in BATCH, if its page table
+ * is the active one. */
+static void
+tlb_batch_flush (struct tlb_batch *batch) {
+	if (batch->cnt == 0 || rcr3 () != vtop (batch->pml4))
+		return;
+	if (batch->cnt > TLB_BATCH_MAX)
+		lcr3 (rcr3 ());
+	else
+		for (size_t i = 0; i < batch->cnt; i++)
+			invlpg (batch->va[i]);
+}
+
+/* Calls FUNC for the PTE of every page in [START, END).  Regions
+ * with no page table are skipped unless CREATE is true, in which
+ * case the tables are allocated.  Returns false only if CREATE is
+ * true and allocation fails. */
+static bool
+pml4_walk_range (uint64_t *pml4, uint64_t start, uint64_t end, int create,
+		pte_range_func *func, void *aux) {
+	const uint64_t pt_span = 1UL << PDXSHIFT;
+	uint64_t va = start;
+
+	ASSERT (pg_ofs (start) == 0);
+	ASSERT (start <= end && is_user_vaddr (end - 1));
+
+	while (va < end) {
+		uint64_t pt_end = (va & ~(pt_span - 1)) + pt_span;
+		uint64_t *pte = pml4e_walk (pml4, va, create);
+
+		if (pt_end > end)
+			pt_end = end;
+		if (pte == NULL) {
+			if (create)
+				return false;
+			va = pt_end;
+			continue;
+		}
+		for (; va < pt_end; va += PGSIZE, pte++)
+			func (pte, va, aux);
+	}
+	return true;
+}
+
+struct map_range_aux {
+	uint64_t start;
+	void *kpage;
+	uint64_t flags;
+};
+
+static void
+map_pte (uint64_t *pte, uint64_t va, void *aux_) {
+	struct map_range_aux *aux = aux_;
+	*pte = vtop (aux->kpage + (va - aux->start)) | aux->flags;
+}
+
+/* Maps CNT user pages starting at UPAGE to the physically
+ * contiguous kernel pages starting at KPAGE.  The pages must not
+ * already be mapped.  Returns false if memory allocation failed. */
+bool
+pml4_set_range (uint64_t *pml4, void *upage, void *kpage, size_t cnt,
+		bool rw) {
+	struct map_range_aux aux = {
+		.start = (uint64_t) upage,
+		.kpage = kpage,
+		.flags = PTE_P | PTE_U | (rw ? PTE_W : 0),
+	};
+
+	ASSERT (pg_ofs (kpage) == 0);
+	ASSERT (pml4 != base_pml4);
+	return pml4_walk_range (pml4, (uint64_t) upage,
+			(uint64_t) upage + cnt * PGSIZE, true, map_pte, &aux);
+}
+
+static void
+clear_pte (uint64_t *pte, uint64_t va, void *batch) {
+	if (*pte & PTE_P) {
+		*pte &= ~PTE_P;
+		tlb_batch_add (batch, va);
+	}
+}
+
+/* Marks every page in [START, END) "not present", like
+ * pml4_clear_page() on each. */
+void
+pml4_clear_range (uint64_t *pml4, void *start, void *end) {
+	struct tlb_batch batch = { .pml4 = pml4 };
+	pml4_walk_range (pml4, (uint64_t) start, (uint64_t) end, false,
+			clear_pte, &batch);
+	tlb_batch_flush (&batch);
+}
+
+/* Returns whether the PTE for VPAGE in PML4 has been accessed and
+ * clears its accessed bit, with a single page-table walk.  Unlike
+ * pml4_set_accessed(), the TLB is left alone: a scanner clearing
+ * many pages should flush once with pml4_flush_tlb() afterwards.
+ *
+ * A 2 MB page has one accessed bit, in its directory entry, for all
+ * of its 4 kB pages.  It is tested for each of them but cleared only
+ * for the last one, so that a scan in ascending order gives the
+ * whole region one second chance per sweep instead of finding the
+ * other 511 pages unaccessed, evicting them and splitting it. */
+bool
+pml4_test_and_clear_accessed (uint64_t *pml4, const void *vpage) {
+	uint64_t *pde = huge_pde (pml4, vpage);
+	if (pde != NULL) {
+		bool accessed = (*pde & PTE_A) != 0;
+		if (accessed && pg_no (vpage) % HPGCNT == HPGCNT - 1)
+			*pde &= ~PTE_A;
+		return accessed;
+	}
+
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	if (pte == NULL || !(*pte & PTE_A))
+		return false;
+	*pte &= ~PTE_A;
+	return true;
+}
+
+/* Flushes the TLB entries of PML4 if it is the active page table. */
+void
+pml4_flush_tlb (uint64_t *pml4) {
+	if (pml4 != NULL && rcr3 () == vtop (pml4))
+		lcr3 (rcr3 ());
+}
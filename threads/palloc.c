@@ -7,9 +7,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/init.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -38,10 +40,25 @@ static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* User pages that are already zeroed.  The page zeroing thread
+   refills this while the system is otherwise idle, so that
+   PAL_USER | PAL_ZERO requests (fresh anonymous memory) do not pay
+   for the memset on the faulting thread. */
+#define ZERO_POOL_PAGES 32
+static struct lock zero_pool_lock;
+static void *zero_pool[ZERO_POOL_PAGES];
+static size_t zero_pool_cnt;
+static struct semaphore zero_pool_room;  /* Free slots to refill. */
+
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void *pool_get_multiple (struct pool *, size_t page_cnt);
+static void *pool_get_aligned (struct pool *, size_t page_cnt, size_t align);
+static void *zero_pool_take (void);
+static void page_zeroer (void *aux UNUSED);
 
 /* multiboot info */
 struct multiboot_info {
@@ -250,9 +267,19 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+	lock_init (&zero_pool_lock);
+	sema_init (&zero_pool_room, ZERO_POOL_PAGES);
 	return ext_mem.end;
 }
 
+/* Starts the thread that keeps the pool of pre-zeroed user pages
+   filled.  It runs at PRI_MIN, so it only zeroes pages when no
+   other thread wants the CPU. */
+void
+palloc_start_zeroing (void) {
+	thread_create ("page_zeroer", PRI_MIN, page_zeroer, NULL);
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -262,26 +289,153 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	bool from_zero_pool = (flags & PAL_USER) && page_cnt == 1;
+	void *pages = NULL;
+
+	if (from_zero_pool && (flags & PAL_ZERO))
+		pages = zero_pool_take ();
+	if (pages)
+		return pages;
+
+	pages = pool_get_multiple (pool, page_cnt);
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			for (size_t i = 0; i < page_cnt; i++)
+				zero_page (pages + PGSIZE * i);
+	} else {
+		/* The zero pool holds user pages hostage; give them back
+		   before reporting that the user pool is exhausted. */
+		if (from_zero_pool)
+			pages = zero_pool_take ();
+		if (pages == NULL && (flags & PAL_ASSERT))
+			PANIC ("palloc_get: out of pages");
+	}
+
+	return pages;
+}
 
+/* Marks PAGE_CNT contiguous pages in POOL as used and returns the
+   first, or a null pointer if there is no such run. */
+static void *
+pool_get_multiple (struct pool *pool, size_t page_cnt) {
 	lock_acquire (&pool->lock);
 	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
 	lock_release (&pool->lock);
-	void *pages;
 
 	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+		return pool->base + PGSIZE * page_idx;
+	return NULL;
+}
+
+/* Obtains PAGE_CNT contiguous free pages whose first page is
+   aligned to ALIGN bytes, a power of two no smaller than PGSIZE,
+   and returns its kernel virtual address.  Otherwise behaves like
+   palloc_get_multiple(), except that the zero pool is not used. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt, size_t align) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	void *pages;
 
+	ASSERT (align >= PGSIZE && (align & (align - 1)) == 0);
+
+	pages = pool_get_aligned (pool, page_cnt, align);
 	if (pages) {
 		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
-	} else {
-		if (flags & PAL_ASSERT)
-			PANIC ("palloc_get: out of pages");
+			for (size_t i = 0; i < page_cnt; i++)
+				zero_page (pages + PGSIZE * i);
+	} else if (flags & PAL_ASSERT)
+		PANIC ("palloc_get: out of pages");
+	return pages;
+}
+
+/* Like pool_get_multiple(), but the run must start at an address
+   aligned to ALIGN bytes. */
+static void *
+pool_get_aligned (struct pool *pool, size_t page_cnt, size_t align) {
+	size_t step = align / PGSIZE;
+	size_t base_no = pg_no (pool->base);
+	size_t page_idx = ROUND_UP (base_no, step) - base_no;
+	size_t found = BITMAP_ERROR;
+
+	lock_acquire (&pool->lock);
+	while (page_idx < bitmap_size (pool->used_map)) {
+		size_t idx = bitmap_scan (pool->used_map, page_idx, page_cnt, false);
+		if (idx == BITMAP_ERROR)
+			break;
+		if (idx == page_idx) {
+			bitmap_set_multiple (pool->used_map, idx, page_cnt, true);
+			found = idx;
+			break;
+		}
+		/* Retry from the first aligned page of the free run. */
+		page_idx = ROUND_UP (base_no + idx, step) - base_no;
 	}
+	lock_release (&pool->lock);
 
-	return pages;
+	if (found != BITMAP_ERROR)
+		return pool->base + PGSIZE * found;
+	return NULL;
+}
+
+/* Removes and returns a page from the zero pool, or a null pointer
+   if it is empty. */
+static void *
+zero_pool_take (void) {
+	void *page = NULL;
+
+	lock_acquire (&zero_pool_lock);
+	if (zero_pool_cnt > 0)
+		page = zero_pool[--zero_pool_cnt];
+	lock_release (&zero_pool_lock);
+
+	if (page != NULL)
+		sema_up (&zero_pool_room);
+	return page;
+}
+
+/* Thread function for the page zeroing thread.  Each unit of
+   ZERO_POOL_ROOM is one empty slot in the zero pool. */
+static void
+page_zeroer (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&zero_pool_room);
+
+		void *page = pool_get_multiple (&user_pool, 1);
+		if (page == NULL) {
+			/* User memory is under pressure; back off instead of
+			   competing with eviction for frames. */
+			sema_up (&zero_pool_room);
+			timer_sleep (TIMER_FREQ / 10);
+			continue;
+		}
+		zero_page (page);
+
+		lock_acquire (&zero_pool_lock);
+		zero_pool[zero_pool_cnt++] = page;
+		lock_release (&zero_pool_lock);
+	}
+}
+
+/* Fills the page at KVA with zeros. */
+void
+zero_page (void *kva) {
+	size_t cnt = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (kva) == 0);
+	asm volatile ("rep stosq"
+			: "+D" (kva), "+c" (cnt) : "a" (0) : "memory");
+}
+
+/* Copies the page at SRC to the page at DST. */
+void
+copy_page (void *dst, const void *src) {
+	size_t cnt = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (dst) == 0);
+	ASSERT (pg_ofs (src) == 0);
+	asm volatile ("rep movsq"
+			: "+D" (dst), "+S" (src), "+c" (cnt) : : "memory");
 }
 
 /* Obtains a single free page and returns its kernel virtual
@@ -328,6 +482,22 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the user pool, counting pages
+   that are in use. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the index of KVA, a page in the user pool, among the
+   user pool's pages: 0 for the first, and less than
+   palloc_user_page_cnt() for all. */
+size_t
+palloc_user_page_no (const void *kva) {
+	ASSERT (page_from_pool (&user_pool, (void *) kva));
+	return pg_no (kva) - pg_no (user_pool.base);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -207,10 +207,8 @@ thread_create (const char *name, int priority,
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 	t->parent = parent_thread;
-	t->file_fdt = palloc_get_multiple(PAL_ZERO, 3);
 	list_push_back(&(parent_thread->child_list), &(t->child_elem));
 	/* Add to run queue. */
-	t->last_fd = 2;
 	thread_unblock (t);
 	
 	return tid;
@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "intrinsic.h"
@@ -147,6 +148,16 @@ page_fault (struct intr_frame *f) {
 		return;
 #endif
 
+	/* A kernel access to user memory through uaccess.c hit a bad
+	   address; let the accessor report it to its caller. */
+	if (!user) {
+		uintptr_t fixup = uaccess_fixup (f->rip);
+		if (fixup != 0) {
+			f->rip = fixup;
+			return;
+		}
+	}
+
 	/* Count page faults. */
 	page_fault_cnt++;
 	exit(-1); 
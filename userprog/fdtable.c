@@ -0,0 +1,152 @@
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+
+#define WORD_BITS 64
+#define WORD_CNT(SIZE) (((SIZE) + WORD_BITS - 1) / WORD_BITS)
+
+static bool resize (struct fd_table *, int size);
+
+/* Initializes T as an empty table.  Nothing is allocated until a
+ * file is installed. */
+void
+fd_table_init (struct fd_table *t) {
+	t->files = NULL;
+	t->used = NULL;
+	t->size = 0;
+	t->open_cnt = 0;
+}
+
+/* Grows T to SIZE slots, which must be a multiple of WORD_BITS.
+ * Returns false if out of memory, leaving T unchanged. */
+static bool
+resize (struct fd_table *t, int size) {
+	struct file **files;
+	uint64_t *used;
+
+	ASSERT (size > t->size && size % WORD_BITS == 0);
+
+	files = calloc (size, sizeof *files);
+	used = calloc (WORD_CNT (size), sizeof *used);
+	if (files == NULL || used == NULL) {
+		free (files);
+		free (used);
+		return false;
+	}
+
+	if (t->size > 0) {
+		memcpy (files, t->files, t->size * sizeof *files);
+		memcpy (used, t->used, WORD_CNT (t->size) * sizeof *used);
+	} else
+		used[0] = (1 << 0) | (1 << 1);      /* Console. */
+	free (t->files);
+	free (t->used);
+	t->files = files;
+	t->used = used;
+	t->size = size;
+	return true;
+}
+
+/* Installs FILE in T at the lowest free descriptor and returns
+ * it, growing T if it is full.  Returns -1 if FD_MAX descriptors
+ * are already open or memory is exhausted. */
+int
+fd_table_install (struct fd_table *t, struct file *file) {
+	int w, fd;
+
+	ASSERT (file != NULL);
+
+	for (w = 0; w < WORD_CNT (t->size); w++)
+		if (t->used[w] != UINT64_MAX)
+			break;
+	if (w == WORD_CNT (t->size)) {
+		int size = t->size > 0 ? t->size * 2 : WORD_BITS;
+		if (size > FD_MAX)
+			size = FD_MAX;
+		if (size <= t->size || !resize (t, size))
+			return -1;
+	}
+
+	fd = w * WORD_BITS + __builtin_ctzll (~t->used[w]);
+	t->used[w] |= 1ULL << (fd % WORD_BITS);
+	t->files[fd] = file;
+	t->open_cnt++;
+	return fd;
+}
+
+/* Returns the file open as FD in T, or a null pointer if FD is
+ * not open. */
+struct file *
+fd_table_get (const struct fd_table *t, int fd) {
+	if (fd < 0 || fd >= t->size)
+		return NULL;
+	return t->files[fd];
+}
+
+/* Removes FD from T and returns the file it held, which the
+ * caller must close, or a null pointer if FD is not open. */
+struct file *
+fd_table_remove (struct fd_table *t, int fd) {
+	struct file *file = fd_table_get (t, fd);
+
+	if (file != NULL) {
+		t->files[fd] = NULL;
+		t->used[fd / WORD_BITS] &= ~(1ULL << (fd % WORD_BITS));
+		t->open_cnt--;
+	}
+	return file;
+}
+
+/* Makes empty table DST a copy of SRC for fork(), duplicating
+ * each open file at the same descriptor.  Only the used bits are
+ * visited, so the cost follows the number of open files rather
+ * than the size of the table.  Returns false if out of memory. */
+bool
+fd_table_copy (struct fd_table *dst, const struct fd_table *src) {
+	int w;
+
+	ASSERT (dst->size == 0);
+
+	if (src->open_cnt == 0)
+		return true;
+	if (!resize (dst, src->size))
+		return false;
+
+	for (w = 0; w < WORD_CNT (src->size); w++) {
+		/* Skip the console bits. */
+		uint64_t bits = src->used[w] & (w == 0 ? ~3ULL : ~0ULL);
+
+		while (bits != 0) {
+			int fd = w * WORD_BITS + __builtin_ctzll (bits);
+			struct file *file = file_duplicate (src->files[fd]);
+
+			if (file == NULL)
+				return false;
+			dst->files[fd] = file;
+			dst->used[w] |= 1ULL << (fd % WORD_BITS);
+			dst->open_cnt++;
+			bits &= bits - 1;
+		}
+	}
+	return true;
+}
+
+/* Closes every file open in T and frees it. */
+void
+fd_table_destroy (struct fd_table *t) {
+	int w;
+
+	for (w = 0; w < WORD_CNT (t->size); w++) {
+		uint64_t bits = t->used[w] & (w == 0 ? ~3ULL : ~0ULL);
+
+		while (bits != 0) {
+			file_close (t->files[w * WORD_BITS + __builtin_ctzll (bits)]);
+			bits &= bits - 1;
+		}
+	}
+	free (t->files);
+	free (t->used);
+	fd_table_init (t);
+}
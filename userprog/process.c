@@ -25,17 +25,38 @@
 #endif
 
 static void process_cleanup (evoid);
-static bool load (const char *file_name, struct intr_frame *if_);
+struct exec_layout;
+static bool load (const char *file_name, struct intr_frame *if_,
+		struct exec_layout *layout);
+static void prefault_exec (const struct exec_layout *layout);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void __do_spawn (void *);
+static bool exec_setup (void *f_name, struct intr_frame *if_);
 void push_argument(char **argv, int argc, struct intr_frame *_if);
 struct thread* find_child(tid_t child_tid);
-struct lazy_load_arg
+/* Pre-faulting at exec.  Binaries with at most PREFAULT_ALL_PAGES
+ * pages of file data are loaded whole before they start; larger
+ * ones get the first PREFAULT_SEG_PAGES pages of each segment,
+ * which cover the entry code and the data touched first. */
+#define PREFAULT_ALL_PAGES 32
+#define PREFAULT_SEG_PAGES 8
+#define PREFAULT_SEG_MAX 8
+
+/* The file-backed PT_LOAD segments found by load(). */
+struct exec_layout
 {
-	struct file *file;
-	off_t ofs;
-	uint32_t read_bytes;
-	uint32_t zero_bytes;
+	int seg_cnt;
+	void *upage[PREFAULT_SEG_MAX];      /* First page of segment. */
+	size_t page_cnt[PREFAULT_SEG_MAX];  /* Pages with file data. */
+};
+
+/* Handed from process_spawn() to the new thread. */
+struct spawn_arg
+{
+	char *cmd_line;             /* Page holding the command line. */
+	struct semaphore loaded;    /* Upped once the load is done. */
+	bool success;               /* Did the load succeed? */
 };
 /* General process initializer for initd and other process. */
 static void
@@ -142,7 +163,7 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	 *    TODO: check whether parent's page is writable or not (set WRITABLE
 	 *    TODO: according to the result). 
 	 * 부모 페이지를 새 페이지로 복제하고 부모 페이지가 쓰기 가능한지 확인합니다(결과에 따라 WRITABLE 설정).*/
-	memcpy(newpage, parent_page, PGSIZE);
+	copy_page(newpage, parent_page);
 	writable = is_writable(pte);
 	/* 5. Add new page to child's page table at address VA with WRITABLE
 	 *    permission. 
@@ -195,18 +216,8 @@ static void
 	}
 #endif
 
-	if (parent->last_fd >= MAX_FILE_DESCRIPTOR){
+	if (!fd_table_copy (&current->fdt, &parent->fdt))
 		goto error;
-	}
-
-	for (size_t i = 2; i < MAX_FILE_DESCRIPTOR; i++)
-	{
-		if (parent->file_fdt[i] != NULL){
-			current->file_fdt[i] = file_duplicate(parent->file_fdt[i]);
-		}
-	}
-	
-	current->last_fd = parent->last_fd;
 
 	
 	
@@ -227,10 +238,77 @@ error:
 	exit(-2);
 }
 
+/* Starts a child process running CMD_LINE, a page from
+ * palloc_get_page() that the child takes over, without copying
+ * the current process's memory or file descriptors as fork()
+ * would.  Returns the child's thread id once its program has
+ * been loaded, or TID_ERROR if it could not be loaded. */
+tid_t
+process_spawn (char *cmd_line) {
+	char name[sizeof thread_current ()->name];
+	struct spawn_arg arg;
+	tid_t tid;
+
+	strlcpy (name, cmd_line, sizeof name);
+	name[strcspn (name, " ")] = '\0';
+
+	arg.cmd_line = cmd_line;
+	sema_init (&arg.loaded, 0);
+	arg.success = false;
+	tid = thread_create (name, PRI_DEFAULT, __do_spawn, &arg);
+	if (tid == TID_ERROR) {
+		palloc_free_page (cmd_line);
+		return TID_ERROR;
+	}
+	sema_down (&arg.loaded);
+	return arg.success ? tid : TID_ERROR;
+}
+
+/* A thread function that loads the program for process_spawn()
+ * straight into a fresh address space. */
+static void
+__do_spawn (void *aux) {
+	struct spawn_arg *arg = aux;
+	char *cmd_line = arg->cmd_line;
+	struct intr_frame _if;
+	bool success;
+
+#ifdef VM
+	supplemental_page_table_init (&thread_current ()->spt);
+#endif
+	process_init ();
+
+	success = exec_setup (cmd_line, &_if);
+	arg->success = success;
+	sema_up (&arg->loaded);
+	/* ARG is gone once the parent runs again. */
+	if (!success) {
+		palloc_free_page (cmd_line);
+		exit (-1);
+	}
+	do_iret (&_if);
+	NOT_REACHED ();
+}
+
 /* Switch the current execution context to the f_name.
  * Returns -1 on fail. */
 int
 process_exec (void *f_name) {
+	struct intr_frame _if;
+
+	if (!exec_setup (f_name, &_if))
+		return -1;
+
+	/* Start switched process. */
+	do_iret (&_if);
+	NOT_REACHED ();
+}
+
+/* Replaces the current address space with the program and
+ * arguments in F_NAME and fills IF_ with its initial user
+ * context.  F_NAME is freed on success. */
+static bool
+exec_setup (void *f_name, struct intr_frame *if_) {
 	const int MAX_ARGUMENTS = 128;
 	struct thread* current_thread = thread_current();
 
@@ -240,14 +318,14 @@ process_exec (void *f_name) {
 	int argc = 0;
 	char *saveptr;
 	char *argv[MAX_ARGUMENTS];
+	struct exec_layout layout;
 	
 	/* We cannot use the intr_frame in the thread structure.
 	 * This is because when current thread rescheduled,
 	 * it stores the execution information to the member. */
-	struct intr_frame _if;
-	_if.ds = _if.es = _if.ss = SEL_UDSEG;
-	_if.cs = SEL_UCSEG;
-	_if.eflags = FLAG_IF | FLAG_MBS;
+	if_->ds = if_->es = if_->ss = SEL_UDSEG;
+	if_->cs = SEL_UCSEG;
+	if_->eflags = FLAG_IF | FLAG_MBS;
 	
 	/* We first kill the current context */
 	process_cleanup ();
@@ -269,19 +347,38 @@ process_exec (void *f_name) {
 	file_name = argv[0];
 	/* And then load the binary */
 	lock_acquire(&filesys_lock);
-	success = load (file_name, &_if);
+	success = load (file_name, if_, &layout);
 	lock_release(&filesys_lock);
 	/* If load failed, quit. */
 	if (!success)
 		// palloc_free_page (file_name);					
-    	return -1;
+    	return false;
+
+	/* Outside filesys_lock: claiming a page may evict a dirty
+	 * file-backed page, which takes the lock. */
+	prefault_exec (&layout);
 
-	push_argument(argv ,argc, &_if);
+	push_argument(argv ,argc, if_);
 	
 	palloc_free_page (file_name);
-	/* Start switched process. */
-	do_iret (&_if);					
-	NOT_REACHED ();
+	return true;
+}
+
+/* Loads the pages of a freshly loaded program that it is about to
+ * touch, in a few large reads instead of one fault per page. */
+static void
+prefault_exec (const struct exec_layout *layout) {
+	size_t total = 0;
+	int i;
+
+	for (i = 0; i < layout->seg_cnt; i++)
+		total += layout->page_cnt[i];
+	for (i = 0; i < layout->seg_cnt; i++) {
+		size_t cnt = layout->page_cnt[i];
+		if (total > PREFAULT_ALL_PAGES && cnt > PREFAULT_SEG_PAGES)
+			cnt = PREFAULT_SEG_PAGES;
+		vm_populate (layout->upage[i], cnt);
+	}
 }
 
 void
@@ -394,13 +491,13 @@ process_exit (void) {
 		}
 		child_element = list_next(child_element);
 	}
-	for (int i = 2 ; i < MAX_FILE_DESCRIPTOR ; i++){
-		close(i);
-	}
+	fd_table_destroy (&current_thread->fdt);
 	if (current_thread->open_file != NULL){
 		file_close(current_thread->open_file);
 	}
-	palloc_free_multiple(current_thread->file_fdt, 3);
+#ifdef VM
+	vm_print_exit_stats ();
+#endif
 	process_cleanup ();
 	
 }
@@ -411,6 +508,8 @@ process_cleanup (void) {
 	struct thread *curr = thread_current ();
 
 #ifdef VM
+	/* Frees every user frame.  The page-table entries are left
+	 * behind; pml4_destroy() below drops the tables wholesale. */
 	supplemental_page_table_kill (&curr->spt);
 #endif
 
@@ -507,7 +606,8 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
  * and its initial stack pointer into *RSP.
  * Returns true if successful, false otherwise. */
 static bool
-load (const char *file_name, struct intr_frame *if_) {
+load (const char *file_name, struct intr_frame *if_,
+		struct exec_layout *layout) {
 	struct thread *t = thread_current ();
 	struct ELF ehdr;
 	struct file *file = NULL;
@@ -515,6 +615,8 @@ load (const char *file_name, struct intr_frame *if_) {
 	bool success = false;
 	int i;
 
+	layout->seg_cnt = 0;
+
 	/* Allocate and activate page directory. */
 	t->pml4 = pml4_create ();
 	if (t->pml4 == NULL)
@@ -586,6 +688,11 @@ load (const char *file_name, struct intr_frame *if_) {
 					if (!load_segment (file, file_page, (void *) mem_page,
 								read_bytes, zero_bytes, writable))
 						goto done;
+					if (read_bytes > 0 && layout->seg_cnt < PREFAULT_SEG_MAX) {
+						layout->upage[layout->seg_cnt] = (void *) mem_page;
+						layout->page_cnt[layout->seg_cnt++] =
+							DIV_ROUND_UP (read_bytes, PGSIZE);
+					}
 				}
 				else
 					goto done;
@@ -775,16 +882,20 @@ lazy_load_segment(struct page *page, void *aux)
 	off_t ofs = lazy_load_arg->ofs;
 	uint32_t page_read_bytes = lazy_load_arg->read_bytes;
 	uint32_t page_zero_bytes = lazy_load_arg->zero_bytes;
-	
-	lock_acquire(&lazy_load_lock);
-	file_seek(file, ofs);
-	if (file_read(file, page->frame->kva, page_read_bytes) != (int)page_read_bytes)
+
+	/* A positional read leaves the shared file position alone, so
+	 * faults on different pages, in this or other processes, need
+	 * no lock.  A process has one thread, so two faults on the same
+	 * private page cannot overlap; shared pages are loaded once by
+	 * vm/share.c. */
+	if (file_read_at(file, page->frame->kva, page_read_bytes, ofs) != (int)page_read_bytes)
 	{
-		palloc_free_page(page->frame->kva);
 		return false;
 	}
 	memset(page->frame->kva + page_read_bytes, 0, page_zero_bytes);
-	lock_release(&lazy_load_lock);
+	/* Loading wrote the frame through the kernel's alias of it;
+	 * that does not make the page differ from its file. */
+	vm_page_clear_dirty(page);
 	
 	// free(lazy_load_arg);
 	return true;
@@ -820,15 +931,28 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		struct lazy_load_arg *aux = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
-		aux->file = file;
-		aux->ofs = ofs;
-		aux->read_bytes = page_read_bytes;
-		aux->zero_bytes = page_zero_bytes;
-		if (!vm_alloc_page_with_initializer(VM_ANON, upage, writable, lazy_load_segment, aux)){
-			return false;
-		}	
+		/* Pages wholly in the bss are plain anonymous memory, which
+		 * the VM layer can back with pre-zeroed or 2 MB frames. */
+		if (page_read_bytes == 0)
+		{
+			if (!vm_alloc_page(VM_ANON, upage, writable))
+				return false;
+		}
+		else
+		{
+			/* TODO: Set up aux to pass information to the lazy_load_segment. */
+			struct lazy_load_arg *aux = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
+			aux->file = file;
+			aux->ofs = ofs;
+			aux->read_bytes = page_read_bytes;
+			aux->zero_bytes = page_zero_bytes;
+			/* Read-only pages are the same in every process
+			 * running this file, so they share frames. */
+			enum vm_type type = writable ? VM_ANON : VM_ANON | VM_SHARED;
+			if (!vm_alloc_page_with_initializer(type, upage, writable, lazy_load_segment, aux)){
+				return false;
+			}
+		}
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
@@ -5,20 +5,29 @@
 #include "threads/thread.h"
 #include "threads/loader.h"
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "threads/palloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include "userprog/uaccess.h"
+#include <mman.h>
+#include <round.h>
+#include <uio.h>
+#include <vmstat.h>
 
 int process_add_file(struct file *f);
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
-void check_address(void *addr);
+bool copy_in_string(char *dst, const char *ustr, size_t size);
 void halt();
 void exit(int status);
 tid_t fork(const char *name, struct intr_frame *if_);
 int exec(const char *file);
+tid_t spawn(const char *cmd_line);
 int wait(tid_t pid);
 bool create(const char *file, unsigned initial_size);
 bool remove(const char *file);
@@ -26,8 +35,13 @@ int open(const char *file);
 void close(int fd);
 int read(int fd, void *buffer, unsigned size);
 int write(int fd, const void *buffer, unsigned size);
+int readv(int fd, const struct iovec *uiov, int iovcnt);
+int writev(int fd, const struct iovec *uiov, int iovcnt);
+int pread(int fd, void *buffer, unsigned size, off_t offset);
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset);
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset); 
 void munmap (void *addr);
+int vmstat(struct vmstat *ustat);
 bool is_validate_mmap(int fd, struct file *file_object, void* addr, size_t length, off_t offset);
 /* System call.
  *
@@ -42,6 +56,9 @@ bool is_validate_mmap(int fd, struct file *file_object, void* addr, size_t lengt
 #define MSR_LSTAR 0xc0000082		/* Long mode SYSCALL target */
 #define MSR_SYSCALL_MASK 0xc0000084 /* Mask for the eflags */
 
+/* Longest path accepted from user space, including the null. */
+#define PATH_MAX_LEN 256
+
 struct lock filesys_lock;
 
 syscall_init(void)
@@ -68,7 +85,6 @@ void syscall_handler(struct intr_frame *f)
 	struct thread *curr = thread_current();
 	curr->user_rsp = f->rsp;
 	uint64_t syscall_number = f->R.rax;
-	uint64_t rsp = f->rsp;
 	uint64_t ARG0 = f->R.rdi;
 	uint64_t ARG1 = f->R.rsi;
 	uint64_t ARG2 = f->R.rdx;
@@ -76,8 +92,6 @@ void syscall_handler(struct intr_frame *f)
 	uint64_t ARG4 = f->R.r8;
 	uint64_t ARG5 = f->R.r9;
 
-	check_address(rsp);
-
 	switch (syscall_number)
 	{
 	case SYS_HALT:
@@ -92,6 +106,9 @@ void syscall_handler(struct intr_frame *f)
 	case SYS_EXEC:
 		f->R.rax = exec(ARG0);
 		break;
+	case SYS_SPAWN:
+		f->R.rax = spawn(ARG0);
+		break;
 	case SYS_WAIT:
 		f->R.rax = wait(ARG0);
 		break;
@@ -128,6 +145,21 @@ void syscall_handler(struct intr_frame *f)
 	case SYS_MUNMAP:
 		munmap(ARG0);
 		break;
+	case SYS_READV:
+		f->R.rax = readv(ARG0, ARG1, ARG2);
+		break;
+	case SYS_WRITEV:
+		f->R.rax = writev(ARG0, ARG1, ARG2);
+		break;
+	case SYS_PREAD:
+		f->R.rax = pread(ARG0, ARG1, ARG2, ARG3);
+		break;
+	case SYS_PWRITE:
+		f->R.rax = pwrite(ARG0, ARG1, ARG2, ARG3);
+		break;
+	case SYS_VMSTAT:
+		f->R.rax = vmstat(ARG0);
+		break;
 	default:
 		thread_exit();
 	}
@@ -136,21 +168,17 @@ void syscall_handler(struct intr_frame *f)
 	//
 }
 
-void check_address(void *addr)
+/* Copies the user string USTR into DST, which holds SIZE bytes.
+ * Kills the process if USTR cannot be read.  Returns false if the
+ * string does not fit. */
+bool copy_in_string(char *dst, const char *ustr, size_t size)
 {
-	struct thread *t = thread_current();
-	if (addr == NULL)
-	{
-		exit(-1);
-	}
-	if (is_kernel_vaddr(addr))
-	{
-		exit(-1);
-	}
-	if (pml4_get_page(t->pml4, addr) == NULL)
+	int len = strncpy_from_user(dst, ustr, size);
+	if (len < 0)
 	{
 		exit(-1);
 	}
+	return (size_t)len < size;
 }
 
 void halt()
@@ -169,16 +197,49 @@ void exit(int status)
 
 tid_t fork(const char *name, struct intr_frame *if_)
 {
-	return process_fork(name, if_);
+	char thread_name[sizeof thread_current()->name];
+	if (!copy_in_string(thread_name, name, sizeof thread_name))
+	{
+		thread_name[sizeof thread_name - 1] = '\0';
+	}
+	return process_fork(thread_name, if_);
 }
 
 int exec(const char *file)
 {
 	char *input_str = palloc_get_page(0);
-	strlcpy(input_str, file, strlen(file) + 1);
+	if (input_str == NULL)
+	{
+		return -1;
+	}
+	if (strncpy_from_user(input_str, file, PGSIZE) < 0)
+	{
+		palloc_free_page(input_str);
+		exit(-1);
+	}
+	input_str[PGSIZE - 1] = '\0';
 	return process_exec(input_str);
 }
 
+/* Like fork() followed by exec() in the child, but the child
+ * starts out with an empty address space instead of a copy of
+ * ours.  Returns -1 if the program cannot be loaded. */
+tid_t spawn(const char *cmd_line)
+{
+	char *input_str = palloc_get_page(0);
+	if (input_str == NULL)
+	{
+		return TID_ERROR;
+	}
+	if (strncpy_from_user(input_str, cmd_line, PGSIZE) < 0)
+	{
+		palloc_free_page(input_str);
+		exit(-1);
+	}
+	input_str[PGSIZE - 1] = '\0';
+	return process_spawn(input_str);
+}
+
 int wait(tid_t pid)
 {
 	return process_wait(pid);
@@ -186,13 +247,17 @@ int wait(tid_t pid)
 
 bool create(const char *file, unsigned initial_size)
 {
-	lock_acquire(&filesys_lock);
-	if (!strcmp(file, ""))
+	char name[PATH_MAX_LEN];
+	if (!copy_in_string(name, file, sizeof name))
+	{
+		return false;
+	}
+	if (!strcmp(name, ""))
 	{
 		exit(-1);
 	}
-	check_address(file);
-	bool create_result = filesys_create(file, initial_size);
+	lock_acquire(&filesys_lock);
+	bool create_result = filesys_create(name, initial_size);
 
 	lock_release(&filesys_lock);
 	return create_result;
@@ -200,19 +265,31 @@ bool create(const char *file, unsigned initial_size)
 
 bool remove(const char *file)
 {
-	return filesys_remove(file); // 파일 시스템에서 file 이름을 가진 파일을 삭제하는 함수
+	char name[PATH_MAX_LEN];
+	if (!copy_in_string(name, file, sizeof name))
+	{
+		return false;
+	}
+	lock_acquire(&filesys_lock);
+	bool remove_result = filesys_remove(name); // 파일 시스템에서 file 이름을 가진 파일을 삭제하는 함수
+	lock_release(&filesys_lock);
+	return remove_result;
 }
 
 int open(const char *file)
 {
-	check_address(file);
+	char name[PATH_MAX_LEN];
+	if (!copy_in_string(name, file, sizeof name))
+	{
+		return -1;
+	}
 	lock_acquire(&filesys_lock);
-	if (strcmp(file, "") == 0)
+	if (strcmp(name, "") == 0)
 	{
 		lock_release(&filesys_lock);
 		return -1;
 	}
-	struct file *open_file = filesys_open(file);
+	struct file *open_file = filesys_open(name);
 	struct thread *current_thread = thread_current();
 
 	if (open_file == NULL)
@@ -220,112 +297,449 @@ int open(const char *file)
 		lock_release(&filesys_lock);
 		return -1;
 	}
-	int fd;
-	for (fd = current_thread->last_fd; fd < MAX_FILE_DESCRIPTOR; fd++)
+	int fd = fd_table_install(&current_thread->fdt, open_file);
+	if (fd == -1)
 	{
-		if (current_thread->file_fdt[fd] == NULL)
-		{
-			current_thread->file_fdt[fd] = open_file;
-			current_thread->last_fd = fd;
-			lock_release(&filesys_lock);
-			return fd;
-		}
+		file_close(open_file);
 	}
-	current_thread->last_fd = fd;
-
-	// int last_fd = process_add_file(open_file);
-	// if (last_fd == -1){
-	file_close(open_file);
-	
 	lock_release(&filesys_lock);
-	return -1;
+	return fd;
 }
 
 void close(int fd)
 {
-	struct thread *current_thread = thread_current();
-	if (current_thread->file_fdt[fd] == NULL)
+	struct file *file_object = fd_table_remove(&thread_current()->fdt, fd);
+	if (file_object != NULL)
 	{
-		return;
+		file_close(file_object);
 	}
-	file_close(current_thread->file_fdt[fd]);
-	current_thread->file_fdt[fd] = NULL;
 }
 
-int read(int fd, void *buffer, unsigned size)
+/* File data moves straight between the file system and user
+ * buffers.  read() and write() first pin up to PIN_SPAN bytes of
+ * the buffer with user_range_pin(), which faults in any page that
+ * is not resident and keeps the pages from being evicted, then
+ * hand the file system the pages' kernel addresses.  The file
+ * system therefore never takes a page fault, and the eviction a
+ * fault may cause never runs, while filesys_lock is held.
+ *
+ * If a span cannot be pinned (part of it is unmapped, or is stack
+ * that has yet to grow), one page goes through a kernel bounce page
+ * instead, so that copy_to_user/copy_from_user fault it in or
+ * detect the bad pointer. */
+static struct file *
+fd_to_file(int fd)
 {
-	lock_acquire(&filesys_lock);
-	if (fd == 0)
+	return fd_table_get(&thread_current()->fdt, fd);
+}
+
+/* Most bytes of a user buffer that read() and write() pin at once. */
+#define PIN_SPAN (16 * PGSIZE)
+
+/* Pins the next span of the user buffer at UPOS, which has LEFT
+ * bytes remaining, and returns its length, or 0 if it could not be
+ * pinned.  The span ends on a page boundary unless LEFT ends first. */
+static unsigned
+pin_span(const uint8_t *upos, unsigned left, bool write)
+{
+	unsigned span = PIN_SPAN - pg_ofs(upos);
+
+	if (span > left)
 	{
-		input_getc();
-		lock_release(&filesys_lock);
-		return size;
+		span = left;
 	}
+	return user_range_pin(upos, span, write) ? span : 0;
+}
 
-	struct thread *current_thread = thread_current();
-	struct file *file_object = current_thread->file_fdt[fd];
-	struct page *page = spt_find_page(&thread_current()->spt, buffer);
-	if (page != NULL && !page->writable)
+/* Reads SIZE bytes from FILE_OBJECT into kernel buffer BUF, at *POS
+ * if POS is non-null (advancing it) or at the file position
+ * otherwise.
+ *
+ * filesys_lock is not taken.  inode_read_at() reads only an inode's
+ * start sector and length, which never change after inode_create()
+ * because files never grow, and the disk driver serializes its own
+ * requests.  A change that lets files grow or move their data must
+ * take the lock here again. */
+static off_t
+read_kernel(struct file *file_object, void *buf, unsigned size, off_t *pos)
+{
+	off_t got;
+
+	if (pos != NULL)
 	{
-		lock_release(&filesys_lock);
-		exit(-1);
+		got = file_read_at(file_object, buf, size, *pos);
+		*pos += got;
 	}
-	size = file_read(file_object, buffer, size);
-	lock_release(&filesys_lock);
-	return size;
+	else
+	{
+		got = file_read(file_object, buf, size);
+	}
+	return got;
 }
 
-int write(int fd, const void *buffer, unsigned size)
+/* Reads SIZE bytes from FD into user BUFFER.  If POS is non-null
+ * the file is read at *POS, which is advanced, and the file
+ * position is left alone; otherwise the file position is used. */
+static int
+read_common(int fd, void *buffer, unsigned size, off_t *pos)
 {
-	lock_acquire(&filesys_lock);
-	struct thread *current_thread = thread_current();
-	struct file *file_object = current_thread->file_fdt[fd];
+	uint8_t *udst = buffer;
+	unsigned bytes_read = 0;
 
-	if (fd == 1)
+	if (fd == 0 && pos == NULL)
 	{
-		putbuf(buffer, size);
-		lock_release(&filesys_lock);
+		for (; bytes_read < size; bytes_read++)
+		{
+			uint8_t key = input_getc();
+			if (copy_to_user(udst + bytes_read, &key, 1) != 0)
+			{
+				exit(-1);
+			}
+		}
 		return size;
 	}
 
+	struct file *file_object = fd_to_file(fd);
 	if (file_object == NULL)
 	{
-		lock_release(&filesys_lock);
 		return -1;
 	}
 
-	size = file_write(file_object, buffer, size);
+	uint8_t *bounce = NULL;
+	while (bytes_read < size)
+	{
+		uint8_t *upos = udst + bytes_read;
+		unsigned span = pin_span(upos, size - bytes_read, true);
+		bool short_read = false;
+
+		if (span > 0)
+		{
+			unsigned done = 0;
+
+			while (done < span && !short_read)
+			{
+				unsigned chunk = PGSIZE - pg_ofs(upos + done);
+				if (chunk > span - done)
+				{
+					chunk = span - done;
+				}
+				off_t got = read_kernel(file_object,
+										pml4_get_page(thread_current()->pml4, upos + done),
+										chunk, pos);
+				done += got;
+				short_read = (unsigned)got < chunk;
+			}
+			user_range_unpin(upos, span, done > 0);
+			bytes_read += done;
+		}
+		else
+		{
+			unsigned chunk = PGSIZE - pg_ofs(upos);
+			if (chunk > size - bytes_read)
+			{
+				chunk = size - bytes_read;
+			}
+			if (bounce == NULL && (bounce = palloc_get_page(0)) == NULL)
+			{
+				return bytes_read > 0 ? (int)bytes_read : -1;
+			}
+			off_t got = read_kernel(file_object, bounce, chunk, pos);
+			if (copy_to_user(upos, bounce, got) != 0)
+			{
+				palloc_free_page(bounce);
+				exit(-1);
+			}
+			bytes_read += got;
+			short_read = (unsigned)got < chunk;
+		}
+		if (short_read)
+		{
+			break;
+		}
+	}
+	palloc_free_page(bounce);
+	return bytes_read;
+}
+
+int read(int fd, void *buffer, unsigned size)
+{
+	return read_common(fd, buffer, size, NULL);
+}
+
+/* Writes SIZE bytes from kernel buffer BUF to FD, at *POS if POS
+ * is non-null (advancing it) or at the file position otherwise. */
+static off_t
+write_kernel(int fd, struct file *file_object, const void *buf, unsigned size,
+			 off_t *pos)
+{
+	off_t put = size;
+
+	if (fd == 1 && pos == NULL)
+	{
+		putbuf(buf, size);
+		return put;
+	}
+	lock_acquire(&filesys_lock);
+	if (pos != NULL)
+	{
+		put = file_write_at(file_object, buf, size, *pos);
+		*pos += put;
+	}
+	else
+	{
+		put = file_write(file_object, buf, size);
+	}
 	lock_release(&filesys_lock);
-	return size;
+	return put;
+}
+
+/* Writes SIZE bytes from user BUFFER to FD, at *POS if POS is
+ * non-null or at the file position otherwise. */
+static int
+write_common(int fd, const void *buffer, unsigned size, off_t *pos)
+{
+	const uint8_t *usrc = buffer;
+	unsigned bytes_written = 0;
+	struct file *file_object = fd_to_file(fd);
+
+	if ((fd != 1 || pos != NULL) && file_object == NULL)
+	{
+		return -1;
+	}
+
+	uint8_t *bounce = NULL;
+	while (bytes_written < size)
+	{
+		const uint8_t *upos = usrc + bytes_written;
+		unsigned span = pin_span(upos, size - bytes_written, false);
+		off_t put;
+
+		if (span > 0)
+		{
+			unsigned done = 0;
+
+			while (done < span)
+			{
+				unsigned chunk = PGSIZE - pg_ofs(upos + done);
+				if (chunk > span - done)
+				{
+					chunk = span - done;
+				}
+				put = write_kernel(fd, file_object,
+								   pml4_get_page(thread_current()->pml4, upos + done),
+								   chunk, pos);
+				done += put;
+				if ((unsigned)put < chunk)
+				{
+					break;
+				}
+			}
+			user_range_unpin(upos, span, false);
+			bytes_written += done;
+			if (done < span)
+			{
+				break;
+			}
+		}
+		else
+		{
+			unsigned chunk = PGSIZE - pg_ofs(upos);
+			if (chunk > size - bytes_written)
+			{
+				chunk = size - bytes_written;
+			}
+			if (bounce == NULL && (bounce = palloc_get_page(0)) == NULL)
+			{
+				return bytes_written > 0 ? (int)bytes_written : -1;
+			}
+			if (copy_from_user(bounce, upos, chunk) != 0)
+			{
+				palloc_free_page(bounce);
+				exit(-1);
+			}
+			put = write_kernel(fd, file_object, bounce, chunk, pos);
+			bytes_written += put;
+			if ((unsigned)put < chunk)
+			{
+				break;
+			}
+		}
+	}
+	palloc_free_page(bounce);
+	return bytes_written;
+}
+
+int write(int fd, const void *buffer, unsigned size)
+{
+	return write_common(fd, buffer, size, NULL);
+}
+
+/* Copies the IDX'th element of user iovec array UIOV into IOV.
+ * Returns false if it cannot be read, in which case the caller
+ * must release what it holds and kill the process. */
+static bool
+copy_in_iovec(struct iovec *iov, const struct iovec *uiov, int idx)
+{
+	return copy_from_user(iov, uiov + idx, sizeof *iov) == 0;
+}
+
+/* Scatter read: fills the IOVCNT buffers described by UIOV in
+ * order with one system call, stopping at end of file. */
+int readv(int fd, const struct iovec *uiov, int iovcnt)
+{
+	unsigned total = 0;
+	int i;
+
+	if (iovcnt < 0 || iovcnt > IOV_MAX)
+	{
+		return -1;
+	}
+	for (i = 0; i < iovcnt; i++)
+	{
+		struct iovec iov;
+		int got;
+
+		if (!copy_in_iovec(&iov, uiov, i))
+		{
+			exit(-1);
+		}
+		got = read_common(fd, iov.iov_base, iov.iov_len, NULL);
+		if (got < 0)
+		{
+			return total > 0 ? (int)total : -1;
+		}
+		total += got;
+		if ((size_t)got < iov.iov_len)
+		{
+			break;
+		}
+	}
+	return total;
+}
+
+/* Gather write: the IOVCNT buffers described by UIOV are packed
+ * into the kernel bounce page and handed to the file system a
+ * page at a time, so many small buffers cost one file_write()
+ * rather than one each. */
+int writev(int fd, const struct iovec *uiov, int iovcnt)
+{
+	struct file *file_object = fd_to_file(fd);
+	unsigned total = 0, fill = 0;
+	uint8_t *bounce;
+	int i;
+
+	if (iovcnt < 0 || iovcnt > IOV_MAX || (fd != 1 && file_object == NULL))
+	{
+		return -1;
+	}
+	bounce = palloc_get_page(0);
+	if (bounce == NULL)
+	{
+		return -1;
+	}
+	for (i = 0; i < iovcnt; i++)
+	{
+		struct iovec iov;
+		size_t done = 0;
+
+		if (!copy_in_iovec(&iov, uiov, i))
+		{
+			palloc_free_page(bounce);
+			exit(-1);
+		}
+		while (done < iov.iov_len)
+		{
+			size_t chunk = iov.iov_len - done;
+			if (chunk > PGSIZE - fill)
+			{
+				chunk = PGSIZE - fill;
+			}
+			if (copy_from_user(bounce + fill,
+							   (const uint8_t *)iov.iov_base + done, chunk) != 0)
+			{
+				palloc_free_page(bounce);
+				exit(-1);
+			}
+			fill += chunk;
+			done += chunk;
+
+			if (fill == PGSIZE)
+			{
+				off_t put = write_kernel(fd, file_object, bounce, fill, NULL);
+				total += put;
+				if ((unsigned)put < fill)
+				{
+					palloc_free_page(bounce);
+					return total;
+				}
+				fill = 0;
+			}
+		}
+	}
+	if (fill > 0)
+	{
+		total += write_kernel(fd, file_object, bounce, fill, NULL);
+	}
+	palloc_free_page(bounce);
+	return total;
+}
+
+/* Positional I/O: reads or writes at OFFSET without using or
+ * moving the file position, so processes sharing an open file
+ * need not seek first. */
+int pread(int fd, void *buffer, unsigned size, off_t offset)
+{
+	if (offset < 0)
+	{
+		return -1;
+	}
+	return read_common(fd, buffer, size, &offset);
+}
+
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset)
+{
+	if (offset < 0)
+	{
+		return -1;
+	}
+	return write_common(fd, buffer, size, &offset);
 }
 
 int filesize(int fd)
 {
 
-	struct thread *current_thread = thread_current();
-	struct file *file_object = current_thread->file_fdt[fd];
+	struct file *file_object = fd_to_file(fd);
 	return file_length(file_object);
 }
 
 void seek(int fd, unsigned position)
 {
-	struct thread *current_thread = thread_current();
-	struct file *file_object = current_thread->file_fdt[fd];
+	struct file *file_object = fd_to_file(fd);
 	file_seek(file_object, position);
 }
 
 unsigned
 tell(int fd)
 {
-	struct thread *current_thread = thread_current();
-	struct file *file_object = current_thread->file_fdt[fd];
+	struct file *file_object = fd_to_file(fd);
 	return file_tell(file_object);
 }
 
+/* WRITABLE may carry MAP_POPULATE, which loads the whole mapping
+ * before returning instead of one page per fault. */
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
-	struct thread *current_thread = thread_current();
-	struct file *file_object = current_thread->file_fdt[fd];
+	struct file *file_object = fd_to_file(fd);
+	bool populate = (writable & MAP_POPULATE) != 0;
+	void *mapping;
+
+	/* WRITABLE is 0 or 1, optionally ORed with MAP_POPULATE.  Any
+	 * other bit is rejected rather than read as "read-only". */
+	if ((writable & ~(1 | MAP_POPULATE)) != 0)
+	{
+		return NULL;
+	}
+	writable &= ~MAP_POPULATE;
 
 	if(!is_validate_mmap(fd, file_object, addr, length, offset)){
 		return NULL;
@@ -335,7 +749,12 @@ mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 		length = file_length(file_object);
 	}
 	
-	return do_mmap(addr, length, writable, file_reopen(file_object), offset);
+	mapping = do_mmap(addr, length, writable, file_reopen(file_object), offset);
+	if (mapping != NULL && populate)
+	{
+		vm_populate(mapping, DIV_ROUND_UP(length, PGSIZE));
+	}
+	return mapping;
 }
 bool
 is_validate_mmap(int fd, struct file *file_object, void* addr, size_t length, off_t offset){
@@ -345,7 +764,7 @@ is_validate_mmap(int fd, struct file *file_object, void* addr, size_t length, of
 	if (file_object == NULL){
 		return false;
 	}
-	if ((fd < 2 && fd > -1 )|| fd > MAX_FILE_DESCRIPTOR){
+	if ((fd < 2 && fd > -1 )|| fd >= FD_MAX){
 		return false;
 	}
 
@@ -371,3 +790,17 @@ void
 munmap (void *addr) {
 	do_munmap(addr);
 }
+
+/* Copies the paging counters of the calling process to USTAT.
+ * Returns 0; kills the process if USTAT cannot be written. */
+int vmstat(struct vmstat *ustat)
+{
+	struct vmstat stat;
+
+	vm_get_stat(&stat);
+	if (copy_to_user(ustat, &stat, sizeof stat) != 0)
+	{
+		exit(-1);
+	}
+	return 0;
+}
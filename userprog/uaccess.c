@@ -0,0 +1,162 @@
+#include "userprog/uaccess.h"
+#include <debug.h>
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* One exception table entry: if an instruction at INSN faults on
+ * a user address, continue at FIXUP. */
+struct ex_entry {
+	uintptr_t insn;
+	uintptr_t fixup;
+};
+
+/* Bounds of the exception table, provided by kernel.lds.S. */
+extern const struct ex_entry __start_ex_table[], __stop_ex_table[];
+
+/* Records "if the instruction at label FROM faults, jump to label
+ * TO" in the exception table. */
+#define EX_TABLE(FROM, TO)                 \
+	".pushsection __ex_table, \"a\"\n"     \
+	".balign 8\n"                          \
+	".quad " #FROM ", " #TO "\n"           \
+	".popsection\n"
+
+/* Returns true if SIZE bytes at UADDR lie entirely in user space. */
+static bool
+is_user_range (const void *uaddr, size_t size) {
+	uintptr_t start = (uintptr_t) uaddr;
+	return start + size >= start && start + size <= KERN_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST.
+ * Returns the number of bytes that could NOT be copied, so 0 means
+ * success. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	if (!is_user_range (usrc, size))
+		return size;
+
+	/* On an unrecoverable fault, RCX holds the bytes left. */
+	asm volatile ("1: rep movsb\n"
+			"2:\n"
+			EX_TABLE (1b, 2b)
+			: "+D" (dst), "+S" (usrc), "+c" (size) : : "memory");
+	return size;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address UDST.
+ * Returns the number of bytes that could NOT be copied, so 0 means
+ * success. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size) {
+	if (!is_user_range (udst, size))
+		return size;
+
+	asm volatile ("1: rep movsb\n"
+			"2:\n"
+			EX_TABLE (1b, 2b)
+			: "+D" (udst), "+S" (src), "+c" (size) : : "memory");
+	return size;
+}
+
+/* Reads the byte at user address UADDR.  Returns the byte value,
+ * or -1 if the access faulted. */
+static int
+get_user (const uint8_t *uaddr) {
+	int result;
+
+	/* If the load faults, RESULT keeps the -1 stored before it. */
+	asm volatile ("movl $-1, %0\n"
+			"1: movzbl %1, %0\n"
+			"2:\n"
+			EX_TABLE (1b, 2b)
+			: "=&r" (result) : "m" (*uaddr));
+	return result;
+}
+
+/* Copies the null-terminated string at user address USRC into DST,
+ * which has room for SIZE bytes.  Returns the length of the string,
+ * or -1 if it could not be read.  If the string does not fit, SIZE
+ * is returned and DST is not terminated. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	size_t len;
+
+	for (len = 0; len < size; len++) {
+		const uint8_t *uaddr = (const uint8_t *) usrc + len;
+		int c;
+
+		if (!is_user_vaddr (uaddr) || (c = get_user (uaddr)) == -1)
+			return -1;
+		dst[len] = c;
+		if (c == '\0')
+			return len;
+	}
+	return size;
+}
+
+/* Called by the page fault handler for a fault it could not
+ * resolve in kernel context.  If RIP is a user access recorded in
+ * the exception table, returns the address to resume at;
+ * otherwise returns 0. */
+uintptr_t
+uaccess_fixup (uintptr_t rip) {
+	const struct ex_entry *e;
+
+	for (e = __start_ex_table; e < __stop_ex_table; e++)
+		if (e->insn == rip)
+			return e->fixup;
+	return 0;
+}
+
+/* Makes every user page overlapping [UBUF, UBUF + SIZE) of the
+ * current process resident (and writable, if WRITE), faulting pages
+ * in as needed, and keeps them resident until user_range_unpin().
+ * Returns false, with nothing pinned, if some page is unmapped.
+ *
+ * While the range is pinned, the kernel may access it through
+ * pml4_get_page() without faulting, so it can do I/O straight into
+ * or out of user memory while holding locks that the page fault
+ * handler may need. */
+bool
+user_range_pin (const void *ubuf, size_t size, bool write) {
+#ifdef VM
+	return vm_pin_range (ubuf, size, write);
+#else
+	/* Without virtual memory, mapped pages are always resident. */
+	const uint8_t *end = (const uint8_t *) ubuf + size;
+
+	for (const uint8_t *upage = pg_round_down (ubuf); upage < end;
+			upage += PGSIZE) {
+		uint64_t *pte;
+
+		if (!is_user_vaddr (upage))
+			return false;
+		pte = pml4e_walk (thread_current ()->pml4, (uint64_t) upage, false);
+		if (pte == NULL || !(*pte & PTE_P) || !(*pte & PTE_U)
+				|| (write && !is_writable (pte)))
+			return false;
+	}
+	return true;
+#endif
+}
+
+/* Releases a range pinned with user_range_pin().  If WRITTEN, the
+ * kernel stored into the range, which is recorded in the pages'
+ * dirty bits as if the process had written them. */
+void
+user_range_unpin (const void *ubuf, size_t size, bool written) {
+	const uint8_t *end = (const uint8_t *) ubuf + size;
+
+	if (written)
+		for (const uint8_t *upage = pg_round_down (ubuf); upage < end;
+				upage += PGSIZE)
+			pml4_set_dirty (thread_current ()->pml4, upage, true);
+#ifdef VM
+	vm_unpin_range (ubuf, size);
+#endif
+}
@@ -1,18 +1,33 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include <stdio.h>
 #include "devices/disk.h"
+#include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "vm/zswap.h"
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
 static bool anon_swap_in (struct page *page, void *kva);
 static bool anon_swap_out (struct page *page);
 static void anon_destroy (struct page *page);
-struct slot* find_swap_slot(struct page *swap_page);
 
 enum swap{
 	SECOTR_PER_SLOT = PGSIZE/DISK_SECTOR_SIZE,
 };
+
+/* Swap statistics, protected by swap_table_lock. */
+static long long swap_write_cnt;        /* Pages written to swap. */
+static long long swap_write_op_cnt;     /* Disk writes issued for them. */
+static long long swap_read_cnt;         /* Pages read from swap. */
+static long long swap_read_op_cnt;      /* Disk reads issued for them. */
+static long long swap_readahead_cnt;    /* Pages read ahead of a fault. */
+static long long swap_readahead_hit_cnt;/* Read-ahead pages later used. */
+static long long swap_avoided_cnt;      /* Evictions that needed no write. */
+
+/* Pages read by one swap-in, counting the faulting page; 1 disables
+ * read-ahead.  Set with the -swap-ra option. */
+unsigned int swap_readahead_pages = 8;
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
 	.swap_in = anon_swap_in,
@@ -28,7 +43,6 @@ vm_anon_init (void) {
 	swap_disk = disk_get(1,1);
 	list_init(&swap_table);
 	lock_init(&swap_table_lock);
-	lock_init(&lazy_load_lock);
 	disk_sector_t sector_number = disk_size(swap_disk); //size for swaptable
 	int slot_number = (sector_number) / SECOTR_PER_SLOT;
 	for (int i = 1 ; i <= slot_number ; i++){
@@ -46,69 +60,237 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->slot = NULL;
+	anon_page->readahead = false;
+	anon_page->zswap = NULL;
 	return true;
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Swap in the page by read contents from the swap disk.
+ * A page kept in the zswap pool is decompressed and leaves the pool.
+ * A page read from disk keeps its slot: until it is written again, the
+ * slot holds the same data as the frame, and evicting the page
+ * needs no disk write.
+ * The pages that follow PAGE in its owner's address space are read
+ * along with it, in the same disk command, as long as they are
+ * swapped out to the slots that follow its slot and the user pool
+ * has free frames for them; see swap_claim_readahead(). */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
-	struct slot *swap_slot= find_swap_slot(page);
-	disk_sector_t sector_number = swap_slot->slot_number * SECOTR_PER_SLOT;
-	int offset = 0;
-	lock_acquire(&swap_table_lock);
-	for (int i = sector_number - SECOTR_PER_SLOT ; i < sector_number ; i++){
-		disk_read(swap_disk, i, (char*)kva + (DISK_SECTOR_SIZE * offset));
-		offset ++;
+	struct slot *swap_slot = anon_page->slot;
+	struct page *pages[SWAP_READAHEAD_MAX];
+	void *bufs[SWAP_READAHEAD_MAX];
+	size_t cnt = 1;
+
+	if (anon_page->zswap != NULL) {
+		zswap_load(anon_page->zswap, kva);
+		zswap_free(anon_page->zswap);
+		anon_page->zswap = NULL;
+		lock_acquire(&swap_table_lock);
+		page->owner->vmstat.swap_ins++;
+		lock_release(&swap_table_lock);
+		return true;
 	}
+
+	/* vm_do_claim_page() pinned PAGE's frame. */
+	pages[0] = page;
+	bufs[0] = kva;
+
+	while (cnt < swap_readahead_pages) {
+		struct page *next = spt_find_page(&page->owner->spt,
+				(uint8_t *) page->va + cnt * PGSIZE);
+		void *next_kva;
+
+		/* A resident anonymous page has a frame; a swapped-out one
+		 * has none but has a slot. */
+		if (next == NULL || VM_TYPE(next->operations->type) != VM_ANON
+				|| next->frame != NULL || next->anon.slot == NULL
+				|| next->anon.slot->slot_number
+					!= swap_slot->slot_number + (int) cnt)
+			break;
+		/* Reading ahead never evicts. */
+		next_kva = palloc_get_page(PAL_USER);
+		if (next_kva == NULL)
+			break;
+		vm_install_frame(next, next_kva, true);
+		pages[cnt] = next;
+		bufs[cnt++] = next_kva;
+	}
+
+	disk_read_scatter(swap_disk,
+			(swap_slot->slot_number - 1) * SECOTR_PER_SLOT, bufs, cnt,
+			SECOTR_PER_SLOT);
+
+	for (size_t i = 0; i < cnt; i++) {
+		/* Read-ahead pages stay unmapped until first touched. */
+		pages[i]->anon.readahead = i > 0;
+		vm_page_clear_dirty(pages[i]);
+	}
+	for (size_t i = 1; i < cnt; i++)
+		pages[i]->frame->pinned = false;
+
+	lock_acquire(&swap_table_lock);
+	swap_read_cnt += cnt;
+	swap_read_op_cnt++;
+	swap_readahead_cnt += cnt - 1;
+	page->owner->vmstat.swap_ins += cnt;
 	lock_release(&swap_table_lock);
-	swap_slot->page = NULL;
+	return true;
+}
+
+/* Maps PAGE, which swap read-ahead brought into a frame, on its
+ * first touch. */
+bool
+swap_claim_readahead (struct page *page) {
+	ASSERT(page->anon.readahead && page->frame != NULL);
+
+	if (!pml4_set_page(page->owner->pml4, page->va, page->frame->kva,
+				page->writable))
+		return false;
+	page->anon.readahead = false;
+	lock_acquire(&swap_table_lock);
+	swap_readahead_hit_cnt++;
+	lock_release(&swap_table_lock);
+	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk, unless
+ * the slot it was read from still holds the same contents. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
-	struct slot *swap_slot= find_swap_slot(NULL);
-	swap_slot->page = page;
-	disk_sector_t sector_number = swap_slot->slot_number * SECOTR_PER_SLOT;
+	swap_out_cluster(&page, 1);
+	return true;
+}
 
-	int offset = 0;
-	
-	lock_acquire(&swap_table_lock);
-	for (int i = sector_number - SECOTR_PER_SLOT ; i < sector_number ; i++){
-		disk_write(swap_disk, i, (char*)(page->frame->kva) + (DISK_SECTOR_SIZE * offset));
-		offset ++;
+/* Claims up to CNT free swap slots that are consecutive on the swap
+ * disk, one for each of PAGES in order, preferring the first run of
+ * CNT free slots and otherwise the longest shorter one.  Returns the
+ * number of slots claimed.  Must be called with swap_table_lock
+ * held. */
+static size_t
+claim_slot_run (struct page **pages, size_t cnt) {
+	struct list_elem *best = NULL, *run = NULL;
+	size_t best_len = 0, run_len = 0;
+
+	for (struct list_elem *e = list_begin(&swap_table);
+			e != list_end(&swap_table) && best_len < cnt; e = list_next(e)) {
+		struct slot *swap_slot = list_entry(e, struct slot, swap_elem);
+		if (swap_slot->page != NULL) {
+			run_len = 0;
+			continue;
+		}
+		if (run_len++ == 0)
+			run = e;
+		if (run_len > best_len) {
+			best = run;
+			best_len = run_len;
+		}
 	}
-	lock_release(&swap_table_lock);
-	pml4_clear_page(thread_current()->pml4, page->va); // 수정필요
+	if (best_len == 0)
+		PANIC("OVER CAPACITY LIMIT");
+
+	for (size_t i = 0; i < best_len; i++, best = list_next(best)) {
+		struct slot *swap_slot = list_entry(best, struct slot, swap_elem);
+		swap_slot->page = pages[i];
+		pages[i]->anon.slot = swap_slot;
+	}
+	return best_len;
 }
 
-struct slot*
-find_swap_slot(struct page *swap_page){
+/* Swaps out the CNT resident anonymous PAGES together.  Pages still
+ * matching the swap slot they were read from are only unmapped.
+ * Pages that compress well go to the zswap pool.  The rest get slots that are consecutive on the swap disk where
+ * possible, and each run of consecutive slots is written with a
+ * single disk command.  swap_table_lock is held only to claim slots,
+ * not during the writes. */
+void
+swap_out_cluster (struct page **pages, size_t cnt) {
+	struct page *dirty[cnt];
+	const void *bufs[cnt];
+	size_t dirty_cnt = 0;
+
+	ASSERT(cnt * SECOTR_PER_SLOT <= DISK_MAX_SECTORS);
+
+	/* Unmap first, so that the owners fault instead of writing to
+	 * frames that are being written out. */
+	for (size_t i = 0; i < cnt; i++)
+		pml4_clear_page(pages[i]->owner->pml4, pages[i]->va);
+
 	lock_acquire(&swap_table_lock);
-	struct list_elem *slot_elem = list_begin(&swap_table);
-	while(true){
-		struct slot *swap_slot = list_entry(slot_elem, struct slot, swap_elem);
-		if (swap_slot == list_end(&swap_table)){
-			PANIC("OVER CAPACITY LIMIT");
+	for (size_t i = 0; i < cnt; i++) {
+		struct anon_page *anon_page = &pages[i]->anon;
+		pages[i]->owner->vmstat.swap_outs++;
+		if (anon_page->slot != NULL && !vm_page_is_dirty(pages[i])) {
+			swap_avoided_cnt++;
+			continue;
 		}
-		if (swap_slot->page == swap_page){
-			lock_release(&swap_table_lock);
-			return swap_slot;
+		/* A dirty page gives up its old slot so that it can join a
+		 * run with the others. */
+		if (anon_page->slot != NULL) {
+			anon_page->slot->page = NULL;
+			anon_page->slot = NULL;
 		}
-		slot_elem = list_next(slot_elem);
+		dirty[dirty_cnt++] = pages[i];
+	}
+	lock_release(&swap_table_lock);
+
+	/* Pages that compress well stay in memory. */
+	size_t disk_cnt = 0;
+	for (size_t i = 0; i < dirty_cnt; i++) {
+		dirty[i]->anon.zswap = zswap_store(dirty[i]->frame->kva);
+		if (dirty[i]->anon.zswap == NULL)
+			dirty[disk_cnt++] = dirty[i];
 	}
-} 
+	dirty_cnt = disk_cnt;
+
+	lock_acquire(&swap_table_lock);
+	for (size_t done = 0; done < dirty_cnt;) {
+		size_t run_cnt = claim_slot_run(dirty + done, dirty_cnt - done);
+		disk_sector_t sector_number =
+			(dirty[done]->anon.slot->slot_number - 1) * SECOTR_PER_SLOT;
+
+		for (size_t i = 0; i < run_cnt; i++)
+			bufs[i] = dirty[done + i]->frame->kva;
+		lock_release(&swap_table_lock);
+		disk_write_gather(swap_disk, sector_number, bufs, run_cnt,
+				SECOTR_PER_SLOT);
+		lock_acquire(&swap_table_lock);
+		swap_write_cnt += run_cnt;
+		swap_write_op_cnt++;
+		done += run_cnt;
+	}
+	lock_release(&swap_table_lock);
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
-	/*frame table 삭제*/
-	lock_acquire(&frame_table_lock);
-	list_remove (&page->frame->frame_elem);
-	// free(page->frame);
-	palloc_free_page(page->frame->kva);
-	pml4_clear_page(thread_current()->pml4, page->va);
-	lock_release(&frame_table_lock);
+	/* First, so that an eviction writing the page out is done with
+	 * its slot.  A swapped-out page has no frame. */
+	struct frame *frame = vm_take_frame(page);
+
+	if (anon_page->slot != NULL) {
+		lock_acquire(&swap_table_lock);
+		anon_page->slot->page = NULL;
+		lock_release(&swap_table_lock);
+	}
+	if (anon_page->zswap != NULL)
+		zswap_free(anon_page->zswap);
+	if (frame != NULL)
+		vm_free_frame(frame);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void) {
+	printf ("Swap: %lld pages written in %lld writes, "
+			"%lld read in %lld reads, %lld writes avoided\n",
+			swap_write_cnt, swap_write_op_cnt, swap_read_cnt,
+			swap_read_op_cnt, swap_avoided_cnt);
+	printf ("Swap read-ahead: %lld pages, %lld used\n",
+			swap_readahead_cnt, swap_readahead_hit_cnt);
+	if (zswap_pool_pages > 0)
+		zswap_print_stats (swap_read_op_cnt);
 }
@@ -1,15 +1,10 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include <string.h>
+#include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "userprog/process.h"
-struct lazy_load_arg
-{
-	struct file *file;
-	off_t ofs;
-	uint32_t read_bytes;
-	uint32_t zero_bytes;
-};
 static bool file_backed_swap_in(struct page *page, void *kva);
 static bool file_backed_swap_out(struct page *page);
 static void file_backed_destroy(struct page *page);
@@ -49,41 +44,59 @@ bool file_backed_initializer(struct page *page, enum vm_type type, void *kva)
 static bool
 file_backed_swap_in(struct page *page, void *kva)
 {
-	struct file_page *file_page UNUSED = &page->file;
-	/*TODO*/
-	lazy_load_segment(page, page->uninit.aux);
+	struct file_page *file_page = &page->file;
+
+	/* The uninit fields that lazy_load_segment() reads were
+	 * overwritten by file_backed_initializer(). */
+	if (file_read_at(file_page->file, kva, file_page->read_bytes,
+					 file_page->offset) != file_page->read_bytes)
+		return false;
+	memset((uint8_t *)kva + file_page->read_bytes, 0,
+		   PGSIZE - file_page->read_bytes);
+	vm_page_clear_dirty(page);
+	return true;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.  A clean
+ * page matches the file and is simply dropped. */
 static bool
 file_backed_swap_out(struct page *page)
 {
+	/* Unmap first, so that the owner faults instead of writing to
+	 * the frame while it is being written out. */
+	pml4_clear_page(page->owner->pml4, page->va);
 	write_dirty_page(page);
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy(struct page *page)
 {
-	lock_acquire(&frame_table_lock);
+	/* Not resident, or sharing the frame of the page it was forked
+	 * from, which still owns the frame. */
+	struct frame *frame = vm_take_frame(page);
+	if (frame == NULL)
+		return;
 	write_dirty_page(page);
-	list_remove(&page->frame->frame_elem);
-	lock_release(&frame_table_lock);
+	vm_free_frame(frame);
 }
 
+/* Writes resident PAGE back to its file if it was modified, through
+ * any mapping, since it was read. */
 static void
 write_dirty_page(struct page *page)
 {
-	struct file_page *file_page UNUSED = &page->file;
-	struct thread *current_thread = thread_current();
+	struct file_page *file_page = &page->file;
 	lock_acquire(&filesys_lock);
-	if (pml4_is_dirty(current_thread->pml4, page->va))
+	if (vm_page_is_dirty(page))
 	{
-		file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->offset);
-		pml4_set_dirty(current_thread->pml4, page->va, false);
+		/* Clean before writing, so that a change made during the
+		 * write leaves the page dirty again. */
+		vm_page_clear_dirty(page);
+		file_write_at(file_page->file, page->frame->kva, file_page->read_bytes, file_page->offset);
 	}
 	lock_release(&filesys_lock);
-	pml4_clear_page(current_thread->pml4, page->va);
 	// palloc_free_page(page->frame->kva);
 }
 /* Do the mmap */
@@ -153,6 +166,12 @@ void do_munmap(void *addr)
 	struct thread *current_thread = thread_current();
 	struct page *first_page = spt_find_page(&current_thread->spt, addr);
 	int page_count = first_page->page_count;
+
+	/* Unmap the whole region with one page-table walk and a single
+	 * batch of TLB invalidations before any frame goes back to the
+	 * pool.  Clearing only the present bit keeps the dirty bits that
+	 * the destroy hooks check to write pages back. */
+	pml4_clear_range(current_thread->pml4, addr, addr + page_count * PGSIZE);
 	for (int i = 0; i < page_count; i++)
 	{
 		struct page *page = spt_find_page(&current_thread->spt, addr + i * PGSIZE);
@@ -0,0 +1,235 @@
+/* share.c: Read-only executable pages shared between processes.
+ *
+ * Code and read-only data pages of an ELF file are identical in
+ * every process running it, so they are cached by (inode, offset):
+ * the first process to fault on one reads it into a frame, and
+ * later faults, in the same or other processes, map that frame.
+ * Each cache entry counts the pages mapping it and frees its frame
+ * when the last one goes away.
+ *
+ * Shared frames never get a page in the frame table, so they are
+ * never chosen for eviction; a frame lives exactly as long as some
+ * running process maps it. */
+
+#include "vm/vm.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "userprog/process.h"
+
+static bool share_swap_in (struct page *page, void *kva);
+static void share_destroy (struct page *page);
+
+static const struct page_operations share_ops = {
+	.swap_in = share_swap_in,
+	.swap_out = NULL,
+	.destroy = share_destroy,
+	.type = VM_ANON | VM_SHARED,
+};
+
+/* One cached page of an executable. */
+struct share_entry {
+	struct hash_elem elem;      /* Element in share_table. */
+	struct inode *inode;        /* File the page comes from. */
+	off_t ofs;                  /* Offset of the page in the file. */
+	struct frame *frame;        /* Frame holding it, once loaded. */
+	int ref_cnt;                /* Pages mapping (or waiting for) it. */
+	bool loading;               /* Being read in by its creator? */
+};
+
+static struct hash share_table;
+static struct lock share_lock;
+static struct condition share_loaded;   /* Some entry finished loading. */
+
+/* Statistics. */
+static long long share_load_cnt;        /* Pages read from disk. */
+static long long share_hit_cnt;         /* Mappings of a cached frame. */
+
+static hash_hash_func share_hash;
+static hash_less_func share_less;
+
+static uint64_t
+share_hash (const struct hash_elem *e_, void *aux UNUSED) {
+	const struct share_entry *e = hash_entry (e_, struct share_entry, elem);
+	return hash_bytes (&e->inode, sizeof e->inode) ^ hash_int (e->ofs);
+}
+
+static bool
+share_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct share_entry *a = hash_entry (a_, struct share_entry, elem);
+	const struct share_entry *b = hash_entry (b_, struct share_entry, elem);
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->ofs < b->ofs;
+}
+
+/* Initializes the shared page cache. */
+void
+vm_share_init (void) {
+	hash_init (&share_table, share_hash, share_less, NULL);
+	lock_init (&share_lock);
+	cond_init (&share_loaded);
+}
+
+/* Drops a reference to E, freeing it and its frame with the
+ * last one.  share_lock must be held. */
+static void
+share_put (struct share_entry *e) {
+	ASSERT (lock_held_by_current_thread (&share_lock));
+	if (--e->ref_cnt > 0)
+		return;
+	if (e->frame != NULL) {
+		hash_delete (&share_table, &e->elem);
+		vm_free_frame (e->frame);
+	}
+	free (e);
+}
+
+/* Maps PAGE, an uninitialized VM_SHARED page, to the cached frame
+ * for its file and offset, reading the page in if no process has
+ * it yet. */
+bool
+share_claim_page (struct page *page) {
+	struct lazy_load_arg *arg = page->uninit.aux;
+	struct share_entry key, *e;
+	struct hash_elem *found;
+
+	ASSERT (!page->writable);
+
+	key.inode = file_get_inode (arg->file);
+	key.ofs = arg->ofs;
+
+	lock_acquire (&share_lock);
+	found = hash_find (&share_table, &key.elem);
+	if (found != NULL) {
+		e = hash_entry (found, struct share_entry, elem);
+		e->ref_cnt++;
+		while (e->loading)
+			cond_wait (&share_loaded, &share_lock);
+		if (e->frame != NULL)
+			share_hit_cnt++;
+	} else {
+		struct frame *frame;
+		bool ok;
+
+		e = malloc (sizeof *e);
+		if (e == NULL) {
+			lock_release (&share_lock);
+			return false;
+		}
+		e->inode = key.inode;
+		e->ofs = key.ofs;
+		e->frame = NULL;
+		e->ref_cnt = 1;
+		e->loading = true;
+		hash_insert (&share_table, &e->elem);
+		lock_release (&share_lock);
+
+		/* Read the page without holding share_lock, so faults on
+		 * other shared pages are not held up by this one. */
+		frame = vm_get_frame (0);
+
+		ok = file_read_at (arg->file, frame->kva, arg->read_bytes, arg->ofs)
+			== (off_t) arg->read_bytes;
+		memset ((uint8_t *) frame->kva + arg->read_bytes, 0, arg->zero_bytes);
+
+		lock_acquire (&share_lock);
+		e->loading = false;
+		if (ok) {
+			e->frame = frame;
+			share_load_cnt++;
+		} else {
+			hash_delete (&share_table, &e->elem);
+			vm_free_frame (frame);
+		}
+		cond_broadcast (&share_loaded, &share_lock);
+	}
+
+	if (e->frame == NULL) {
+		share_put (e);
+		lock_release (&share_lock);
+		return false;
+	}
+	lock_release (&share_lock);
+
+	page->operations = &share_ops;
+	page->share.entry = e;
+	page->frame = e->frame;
+	return pml4_set_page (thread_current ()->pml4, page->va, e->frame->kva,
+			false);
+}
+
+/* Returns true if the frame that PAGE, an uninitialized VM_SHARED
+ * page, would map is already cached or being read in by another
+ * process, so that claiming PAGE reads nothing itself. */
+bool
+share_is_cached (struct page *page) {
+	struct lazy_load_arg *arg = page->uninit.aux;
+	struct share_entry key;
+	bool cached;
+
+	key.inode = file_get_inode (arg->file);
+	key.ofs = arg->ofs;
+	lock_acquire (&share_lock);
+	cached = hash_find (&share_table, &key.elem) != NULL;
+	lock_release (&share_lock);
+	return cached;
+}
+
+/* Adds to the current process a page that maps the same shared
+ * frame as SRC, for fork(). */
+bool
+share_copy_page (struct page *src) {
+	struct page *page = malloc (sizeof *page);
+
+	if (page == NULL)
+		return false;
+	*page = (struct page) {
+		.operations = &share_ops,
+		.va = src->va,
+		.frame = src->frame,
+		.writable = false,
+		.share = src->share,
+	};
+
+	lock_acquire (&share_lock);
+	page->share.entry->ref_cnt++;
+	share_hit_cnt++;
+	lock_release (&share_lock);
+
+	if (!spt_insert_page (&thread_current ()->spt, page)) {
+		vm_dealloc_page (page);
+		return false;
+	}
+	return pml4_set_page (thread_current ()->pml4, page->va,
+			page->frame->kva, false);
+}
+
+/* Shared frames are never evicted, so they are never swapped
+ * back in. */
+static bool
+share_swap_in (struct page *page UNUSED, void *kva UNUSED) {
+	NOT_REACHED ();
+}
+
+/* Releases PAGE's reference to its shared frame.  PAGE will be
+ * freed by the caller. */
+static void
+share_destroy (struct page *page) {
+	lock_acquire (&share_lock);
+	share_put (page->share.entry);
+	lock_release (&share_lock);
+}
+
+/* Prints shared page statistics. */
+void
+share_print_stats (void) {
+	printf ("Shared text: %lld pages loaded, %lld frames saved\n",
+			share_load_cnt, share_hit_cnt);
+}
@@ -1,9 +1,18 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "intrinsic.h"
+#include <round.h>
+#include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
+#include "userprog/process.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/zswap.h"
 
 unsigned page_hash(const struct hash_elem *p_, void *aux UNUSED);
 bool page_less(const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED);
@@ -12,6 +21,19 @@ bool get_initializer_type(enum vm_type type);
 void hash_destructor(struct hash_elem *hash_elem, void *aux);
 bool is_stack_addr(void *addr, void *rsp);
 bool is_validate(void *addr);
+
+/* Frame table: one descriptor per user pool page, indexed by
+ * palloc_user_page_no().  A descriptor whose page is null is free,
+ * or is held by a caller that has not installed a page yet, or backs
+ * a shared executable page; none of these can be evicted. */
+static struct frame *frame_table;
+static size_t frame_cnt;
+static size_t clock_hand;               /* Next frame vm_get_victims() looks at. */
+
+/* Print each process's paging counters when it exits?
+ * Set by the kernel command-line option "-vmstat". */
+bool vm_exit_stats;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 
@@ -25,8 +47,12 @@ void vm_init(void)
 	register_inspect_intr();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&frame_table);
-	lock_init(&frame_table_lock);
+	frame_cnt = palloc_user_page_cnt();
+	frame_table = palloc_get_multiple(PAL_ASSERT | PAL_ZERO,
+									  DIV_ROUND_UP(frame_cnt * sizeof *frame_table, PGSIZE));
+	vm_share_init();
+	vm_zswap_init();
+	palloc_start_zeroing();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -46,9 +72,18 @@ page_get_type(struct page *page)
 }
 
 /* Helpers */
-static struct frame *vm_get_victim(void);
+static size_t vm_get_victims(struct frame **victims, size_t max);
 static bool vm_do_claim_page(struct page *page);
+static bool vm_claim_huge_page(struct page *page);
 static struct frame *vm_evict_frame(void);
+static size_t populate_run(struct page **pages, size_t cnt);
+
+/* Most pages read by one populate_run() call. */
+#define POPULATE_RUN_MAX 32
+
+/* Pre-fault statistics. */
+static long long populate_page_cnt;     /* Pages read ahead of a fault. */
+static long long populate_read_cnt;     /* File reads that took. */
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -71,7 +106,9 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 
 		init_page = (struct page *)malloc(sizeof(struct page));
 		page_initialized(init_page, pg_round_down(upage), init, type, aux);
+		init_page->owner = thread_current();
 		init_page->writable = writable;
+		init_page->evicting = false;
 		/* TODO: Insert the page into the spt. */
 		return spt_insert_page(spt, init_page);
 	}
@@ -93,16 +130,15 @@ void page_initialized(struct page *init_page, void *upage, vm_initializer *init,
 struct page *
 spt_find_page(struct supplemental_page_table *spt UNUSED, void *va UNUSED)
 {
-	struct page *page = malloc(sizeof(struct page));
+	struct page key;
 	struct hash_elem *hash_element;
 	/* TODO: Fill this function. */
-	page->va = pg_round_down(va);
-	hash_element = hash_find(&spt->spt_hash, &page->hash_elem);
+	key.va = pg_round_down(va);
+	hash_element = hash_find(&spt->spt_hash, &key.hash_elem);
 	if (hash_element == NULL)
 	{
 		return NULL;
 	}
-	free(page);
 	return hash_entry(hash_element, struct page, hash_elem);
 }
 
@@ -126,72 +162,197 @@ void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
 	vm_dealloc_page(page);
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Most frames evicted together when memory runs out.  Their anonymous
+ * pages are written to swap as one cluster. */
+#define EVICT_BATCH 8
+
+/* Returns the descriptor of KVA, a page in the user pool. */
 static struct frame *
-vm_get_victim(void)
+frame_for(void *kva)
+{
+	struct frame *frame = &frame_table[palloc_user_page_no(kva)];
+	frame->kva = kva;
+	return frame;
+}
+
+/* Pins FRAME and returns true if it holds a page and no one else
+ * has pinned it.  Interrupts, not a lock, make the test and the set
+ * one step, so pinning never waits. */
+static bool
+frame_try_pin(struct frame *frame)
+{
+	enum intr_level old_level = intr_disable();
+	bool pinned = !frame->pinned && frame->page != NULL;
+	if (pinned)
+		frame->pinned = true;
+	intr_set_level(old_level);
+	return pinned;
+}
+
+/* Chooses up to MAX frames to evict, stores them in VICTIMS, pins
+ * them so that no one else evicts them meanwhile, marks their pages
+ * as being evicted (see vm_do_claim_page()), and returns how
+ * many it chose, which is at least one.  Sweeps the frame table
+ * like a clock hand, from where the last call stopped. */
+static size_t
+vm_get_victims(struct frame **victims, size_t max)
 {
-	struct frame *victim = NULL;
 	/* TODO: The policy for eviction is up to you. */
-	lock_acquire(&frame_table_lock);
-	struct list_elem *victim_elem = list_begin(&frame_table);
-	while (true)
+	uint64_t *pml4 = thread_current()->pml4;
+	struct frame *fallback = NULL;
+	size_t cnt = 0;
+
+	for (size_t n = 0; n < frame_cnt && cnt < max; n++)
 	{
-		struct frame *victim = list_entry(victim_elem, struct frame, frame_elem);
-		if (!pml4_is_accessed(thread_current()->pml4, victim->page->va))
-		{
-			lock_release(&frame_table_lock);
-			return victim;
-		}
-		pml4_set_accessed(thread_current()->pml4, victim->page->va, false);
-		if (victim == list_entry(list_prev(list_end(&frame_table)), struct frame, frame_elem))
+		struct frame *frame = &frame_table[clock_hand];
+		clock_hand = (clock_hand + 1) % frame_cnt;
+		/* Skips free frames, frames being claimed, which have no
+		 * page yet, and pinned frames.  Once pinned, the frame's page
+		 * and its owner's page table stay valid even if the owner is
+		 * exiting: destroying a page takes the pin first. */
+		if (!frame_try_pin(frame))
+			continue;
+		/* Accessed bits are cleared without invalidating the TLB page
+		 * by page; one flush below covers the whole scan.  Other
+		 * processes' page tables are not loaded, so they need none. */
+		if (pml4_test_and_clear_accessed(frame->page->owner->pml4,
+										 frame->page->va))
 		{
-			lock_release(&frame_table_lock);
-			return victim;
+			frame->pinned = false;
+			fallback = frame;
+			continue;
 		}
-		victim_elem = list_next(victim_elem);
+		frame->page->evicting = true;
+		victims[cnt++] = frame;
+	}
+	/* Every frame was recently used: take the last one seen. */
+	if (cnt == 0 && fallback != NULL && frame_try_pin(fallback))
+	{
+		fallback->page->evicting = true;
+		victims[cnt++] = fallback;
 	}
+	pml4_flush_tlb(pml4);
+
+	if (cnt == 0)
+		PANIC("no frame to evict");
+	return cnt;
 }
 
 /* Evict one page and return the corresponding frame.
+ * Evicts up to EVICT_BATCH pages at a time, writing their anonymous
+ * pages to swap together, and frees the frames of all but the
+ * returned one, so that the next few allocations need no eviction.
  * Return NULL on error.*/
 static struct frame *
 vm_evict_frame(void)
 {
-	struct frame *victim UNUSED = vm_get_victim();
+	struct frame *victims[EVICT_BATCH];
+	struct page *anon_pages[EVICT_BATCH];
+	size_t cnt = vm_get_victims(victims, EVICT_BATCH);
+	size_t anon_cnt = 0;
+
 	/* TODO: swap out the victim and return the evicted frame. */
-	swap_out(victim->page);
-	return victim;
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct page *page = victims[i]->page;
+		if (VM_TYPE(page->operations->type) == VM_ANON)
+			anon_pages[anon_cnt++] = page;
+		else
+			swap_out(page);
+	}
+	if (anon_cnt > 0)
+		swap_out_cluster(anon_pages, anon_cnt);
+
+	/* Only now may the pages' owners fault them back in. */
+	for (size_t i = 0; i < cnt; i++)
+	{
+		victims[i]->page->frame = NULL;
+		victims[i]->page->evicting = false;
+		if (i > 0)
+			vm_free_frame(victims[i]);
+	}
+	return victims[0];
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
  * space.*/
-static struct frame *
-vm_get_frame(void)
+struct frame *
+vm_get_frame(enum palloc_flags flags)
 {
-	struct frame *frame = malloc(sizeof(struct frame));
+	struct frame *frame;
 	/* TODO: Fill this function. */
-	frame->kva = palloc_get_page(PAL_USER);
-
-	lock_acquire(&frame_table_lock);
-	list_push_front(&frame_table, &frame->frame_elem);
-	lock_release(&frame_table_lock);
+	void *kva = palloc_get_page(PAL_USER | flags);
 
-	if (frame->kva == NULL)
+	if (kva != NULL)
+		frame = frame_for(kva);
+	else
 	{
-		list_pop_front(&frame_table);
-		free(frame);
 		frame = vm_evict_frame();
-		// frame->kva = palloc_get_page(PAL_USER);
+		if (flags & PAL_ZERO)
+			zero_page(frame->kva);
 	}
 	frame->page = NULL;
+	frame->pinned = false;
 
 	ASSERT(frame != NULL);
 	ASSERT(frame->page == NULL);
 	return frame;
 }
 
+/* Makes KVA, a page from the user pool that the caller already
+ * allocated, the frame of PAGE, pinned if PINNED.  Does not map
+ * it.  Unlike vm_get_frame(), never evicts. */
+struct frame *
+vm_install_frame(struct page *page, void *kva, bool pinned)
+{
+	struct frame *frame = frame_for(kva);
+	frame->pinned = pinned;
+	/* Only a frame with a page can be evicted. */
+	barrier();
+	frame->page = page;
+	page->frame = frame;
+	return frame;
+}
+
+/* Frees FRAME, whose page, if any, no longer refers to it.  A frame
+ * with a page must be pinned by the caller (see vm_take_frame()), so
+ * that no evictor is using it; one without, such as a shared frame,
+ * is never evicted. */
+void
+vm_free_frame(struct frame *frame)
+{
+	frame->page = NULL;
+	frame->pinned = false;
+	palloc_free_page(frame->kva);
+}
+
+/* Pins the frame of PAGE, which is being destroyed, and returns it
+ * for vm_free_frame().  If an evictor has the frame pinned, waits
+ * for it to finish first; it then takes the frame away from PAGE.
+ * Returns a null pointer if PAGE has no frame of its own. */
+struct frame *
+vm_take_frame(struct page *page)
+{
+	for (;;)
+	{
+		struct frame *frame = page->frame;
+		if (frame == NULL || frame->page != page)
+			return NULL;
+		if (frame_try_pin(frame))
+		{
+			/* An evictor may have given the frame to another page
+			 * between the test above and the pin. */
+			if (page->frame == frame)
+				return frame;
+			frame->pinned = false;
+		}
+		else
+			thread_yield();
+	}
+}
+
 /* Growing the stack. */
 static void
 vm_stack_growth(void *addr UNUSED)
@@ -205,6 +366,30 @@ vm_handle_wp(struct page *page UNUSED)
 {
 }
 
+/* Returns true if bringing in PAGE on a fault reads a file or the
+ * swap disk, which makes the fault a major one.  Zero-filled memory,
+ * shared text already in the cache, and swapped-out pages that sit in
+ * the zswap pool or were read ahead cost no I/O: minor faults. */
+static bool
+fault_reads_disk(struct page *page)
+{
+	if (page->operations->type & VM_SHARED)
+		return false;
+	switch (VM_TYPE(page->operations->type))
+	{
+	case VM_UNINIT:
+		if (page->uninit.init != lazy_load_segment)
+			return false;
+		if ((page->uninit.type & VM_SHARED) && share_is_cached(page))
+			return false;
+		return ((struct lazy_load_arg *)page->uninit.aux)->read_bytes > 0;
+	case VM_ANON:
+		return page->frame == NULL && page->anon.zswap == NULL;
+	default:
+		return page->frame == NULL;
+	}
+}
+
 /* Return true on success */
 bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 						 bool user UNUSED, bool write UNUSED, bool not_present UNUSED)
@@ -239,7 +424,16 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 		return false;
 	}
 	/* TODO: Your code goes here */
-	return vm_claim_page(addr);
+	bool major = fault_reads_disk(page);
+	if (!vm_claim_huge_page(page) && !vm_claim_page(addr))
+	{
+		return false;
+	}
+	if (major)
+		current_thread->vmstat.major_faults++;
+	else
+		current_thread->vmstat.minor_faults++;
+	return true;
 }
 bool is_stack_addr(void *addr, void *rsp)
 {
@@ -275,20 +469,437 @@ bool vm_claim_page(void *va UNUSED)
 	return vm_do_claim_page(page);
 }
 
+/* Returns true if PAGE is fresh anonymous memory: never claimed, and
+ * with no initializer to fill it. */
+static bool
+is_zero_fill(struct page *page)
+{
+	return VM_TYPE(page->operations->type) == VM_UNINIT &&
+		   VM_TYPE(page->uninit.type) == VM_ANON &&
+		   page->uninit.init == NULL;
+}
+
+/* Returns page I of the 2 MB region at BASE if it can be part of a
+ * 2 MB page with protection WRITABLE, otherwise a null pointer. */
+static struct page *
+huge_region_page(struct supplemental_page_table *spt, uint8_t *base,
+				 size_t i, bool writable)
+{
+	struct page *page = spt_find_page(spt, base + i * PGSIZE);
+	if (page == NULL || !is_zero_fill(page) || page->writable != writable)
+		return NULL;
+	return page;
+}
+
+/* Backs the whole 2 MB-aligned region around PAGE with one 2 MB page,
+ * if every page of the region is fresh anonymous memory with the same
+ * protection and the user pool has 2 MB of aligned, contiguous free
+ * frames.  Each page still gets a frame of its own in the frame table;
+ * evicting or unmapping one of them splits the mapping. */
+static bool
+vm_claim_huge_page(struct page *page)
+{
+	struct thread *current_thread = thread_current();
+	struct supplemental_page_table *spt = &current_thread->spt;
+	uint8_t *base = (uint8_t *)((uint64_t)page->va & ~(HPGSIZE - 1));
+	bool writable = page->writable;
+
+	/* Test the ends of the region before looking at all of it. */
+	if (!is_zero_fill(page) ||
+		huge_region_page(spt, base, 0, writable) == NULL ||
+		huge_region_page(spt, base, HPGCNT - 1, writable) == NULL)
+		return false;
+	for (size_t i = 1; i < HPGCNT - 1; i++)
+		if (huge_region_page(spt, base, i, writable) == NULL)
+			return false;
+
+	uint8_t *kva = palloc_get_aligned(PAL_USER | PAL_ZERO, HPGCNT, HPGSIZE);
+	if (kva == NULL)
+		return false;
+	if (!pml4_set_huge_page(current_thread->pml4, base, kva, writable))
+	{
+		palloc_free_multiple(kva, HPGCNT);
+		return false;
+	}
+
+	for (size_t i = 0; i < HPGCNT; i++)
+	{
+		struct page *region_page = spt_find_page(spt, base + i * PGSIZE);
+		struct frame *frame = vm_install_frame(region_page, kva + i * PGSIZE,
+											   false);
+		swap_in(region_page, frame->kva);
+	}
+	return true;
+}
+
+/* If user page UPAGE of the current process is resident (and
+ * writable, if WRITE), pins its frame so that it cannot be evicted
+ * and returns the frame's kernel address.  Otherwise returns a null
+ * pointer.  The kernel may then access the page directly instead of
+ * through a bounce buffer, until vm_unpin_page(). */
+void *
+vm_pin_page(void *upage, bool write)
+{
+	struct thread *current_thread = thread_current();
+	struct page *page = spt_find_page(&current_thread->spt, upage);
+	void *kva = NULL;
+
+	if (page == NULL || (write && !page->writable))
+		return NULL;
+
+	/* Shared executable frames are never evicted. */
+	if (page->operations->type & VM_SHARED)
+		return pml4_get_page(current_thread->pml4, page->va);
+	if (page->frame != NULL && page->frame->page == page &&
+		pml4_get_page(current_thread->pml4, page->va) == page->frame->kva &&
+		frame_try_pin(page->frame))
+		kva = page->frame->kva;
+	return kva;
+}
+
+/* Releases a pin taken by vm_pin_page(). */
+void
+vm_unpin_page(void *upage)
+{
+	struct page *page = spt_find_page(&thread_current()->spt, upage);
+
+	ASSERT(page != NULL && page->frame != NULL);
+	if (!(page->operations->type & VM_SHARED))
+		page->frame->pinned = false;
+}
+
+/* Most times vm_pin_range() tries to fault in and pin one page
+ * that keeps getting evicted before it can be pinned. */
+#define PIN_ATTEMPTS 8
+
+/* Makes user page UPAGE of the current process resident, faulting
+ * it in if needed, and pins it.  Returns false if UPAGE is not
+ * mapped (or not writable, if WRITE) or cannot be loaded. */
+static bool
+pin_user_page(void *upage, bool write)
+{
+	struct page *page = spt_find_page(&thread_current()->spt, upage);
+
+	if (page == NULL || (write && !page->writable))
+		return false;
+	for (int attempt = 0; attempt < PIN_ATTEMPTS; attempt++)
+	{
+		if (vm_pin_page(upage, write) != NULL)
+			return true;
+		/* Not resident, or read ahead and not yet mapped: fault it in.
+		 * Otherwise another thread is evicting it: let it finish. */
+		if (page->frame == NULL ||
+			(VM_TYPE(page->operations->type) == VM_ANON &&
+			 page->anon.readahead))
+		{
+			if (!vm_do_claim_page(page))
+				return false;
+		}
+		else
+			thread_yield();
+	}
+	return false;
+}
+
+/* Pins every page of the current process's user memory that
+ * overlaps [UADDR, UADDR + SIZE), faulting in the ones that are not
+ * resident, and returns true.  Until vm_unpin_range(), the kernel
+ * may then access the range through the frames' kernel addresses
+ * without faulting and without the pages being evicted.  Returns
+ * false, with nothing pinned, if some page cannot be pinned. */
+bool
+vm_pin_range(const void *uaddr, size_t size, bool write)
+{
+	uint8_t *start = pg_round_down(uaddr);
+	uint8_t *end = (uint8_t *)uaddr + size;
+
+	for (uint8_t *upage = start; upage < end; upage += PGSIZE)
+		if (!is_user_vaddr(upage) || !pin_user_page(upage, write))
+		{
+			if (upage > start)
+				vm_unpin_range(start, upage - start);
+			return false;
+		}
+	return true;
+}
+
+/* Releases the pins taken by vm_pin_range(UADDR, SIZE). */
+void
+vm_unpin_range(const void *uaddr, size_t size)
+{
+	uint8_t *end = (uint8_t *)uaddr + size;
+
+	for (uint8_t *upage = pg_round_down(uaddr); upage < end; upage += PGSIZE)
+		vm_unpin_page(upage);
+}
+
+/* Returns true if PAGE is a private page that lazy_load_segment()
+ * would fill from a file on its first fault. */
+static bool
+is_lazy_file_page(struct page *page)
+{
+	return page != NULL && VM_TYPE(page->operations->type) == VM_UNINIT &&
+		   page->uninit.init == lazy_load_segment &&
+		   !(page->uninit.type & VM_SHARED);
+}
+
+/* Returns true if lazy page B directly follows lazy page A both in
+ * memory and in the same file, so that one read can fill both. */
+static bool
+lazy_pages_adjacent(struct page *a, struct page *b)
+{
+	struct lazy_load_arg *x = a->uninit.aux, *y = b->uninit.aux;
+	return (uint8_t *)b->va == (uint8_t *)a->va + PGSIZE &&
+		   x->file == y->file && x->read_bytes == PGSIZE &&
+		   y->ofs == x->ofs + PGSIZE && b->writable == a->writable;
+}
+
+/* Loads the CNT lazy pages in PAGES, which lazy_pages_adjacent()
+ * links into one stretch of one file, with a single read into
+ * contiguous frames.  Returns the number of pages loaded, which is
+ * 0 if no contiguous frames are free; pre-faulting never evicts. */
+static size_t
+populate_run(struct page **pages, size_t cnt)
+{
+	struct thread *current_thread = thread_current();
+	struct lazy_load_arg *first = pages[0]->uninit.aux;
+	struct lazy_load_arg *last = pages[cnt - 1]->uninit.aux;
+	off_t read_bytes = (cnt - 1) * PGSIZE + last->read_bytes;
+	uint8_t *kva = palloc_get_multiple(PAL_USER, cnt);
+
+	if (kva == NULL)
+		return 0;
+	if (file_read_at(first->file, kva, read_bytes, first->ofs) != read_bytes)
+	{
+		palloc_free_multiple(kva, cnt);
+		return 0;
+	}
+	memset(kva + read_bytes, 0, cnt * PGSIZE - read_bytes);
+
+	/* Map the run, which lazy_pages_adjacent() made contiguous and of
+	 * one protection, with one walk before touching the pages, so that
+	 * a failure leaves them uninitialized and without frames. */
+	if (!pml4_set_range(current_thread->pml4, pages[0]->va, kva, cnt,
+						pages[0]->writable))
+	{
+		pml4_clear_range(current_thread->pml4, pages[0]->va,
+						 (uint8_t *)pages[0]->va + cnt * PGSIZE);
+		palloc_free_multiple(kva, cnt);
+		return 0;
+	}
+
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct page *page = pages[i];
+		struct frame *frame = vm_install_frame(page, kva + i * PGSIZE, false);
+		/* The data is in place: turn the page into its final type
+		 * without running its initializer. */
+		page->uninit.page_initializer(page, page->uninit.type, frame->kva);
+		vm_page_clear_dirty(page);
+	}
+	populate_page_cnt += cnt;
+	populate_read_cnt++;
+	return cnt;
+}
+
+/* Loads the CNT pages starting at UPAGE of the current process
+ * that are not yet resident, so that touching them later does not
+ * fault.  Pages that follow one another in the same file are read
+ * POPULATE_RUN_MAX at a time; other pages are claimed one by one.
+ * Stops early, leaving the rest to be faulted in, when memory
+ * runs short.  Returns the number of pages loaded. */
+size_t
+vm_populate(void *upage, size_t cnt)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct page *run[POPULATE_RUN_MAX];
+	uint8_t *va = pg_round_down(upage);
+	size_t loaded = 0;
+
+	for (size_t i = 0; i < cnt;)
+	{
+		struct page *page = spt_find_page(spt, va + i * PGSIZE);
+		size_t run_cnt = 0;
+
+		if (page == NULL ||
+			VM_TYPE(page->operations->type) != VM_UNINIT)
+		{
+			i++;
+			continue;
+		}
+		if (!is_lazy_file_page(page))
+		{
+			if (!vm_do_claim_page(page))
+				break;
+			loaded++;
+			i++;
+			continue;
+		}
+
+		run[run_cnt++] = page;
+		while (run_cnt < POPULATE_RUN_MAX && i + run_cnt < cnt)
+		{
+			struct page *next = spt_find_page(spt, va + (i + run_cnt) * PGSIZE);
+			if (!is_lazy_file_page(next) ||
+				!lazy_pages_adjacent(run[run_cnt - 1], next))
+				break;
+			run[run_cnt++] = next;
+		}
+		if (populate_run(run, run_cnt) == 0)
+			break;
+		loaded += run_cnt;
+		i += run_cnt;
+	}
+	return loaded;
+}
+
+/* Returns true if resident PAGE was written since it was loaded or
+ * last cleaned, through its owner's mapping or through the kernel's
+ * alias of its frame, which system calls and loaders write to. */
+bool
+vm_page_is_dirty(struct page *page)
+{
+	ASSERT(page->frame != NULL);
+	return pml4_is_dirty(page->owner->pml4, page->va) ||
+		   pml4_is_dirty(base_pml4, page->frame->kva);
+}
+
+/* Marks resident PAGE clean in both of the mappings that
+ * vm_page_is_dirty() checks. */
+void
+vm_page_clear_dirty(struct page *page)
+{
+	ASSERT(page->frame != NULL);
+	pml4_set_dirty(page->owner->pml4, page->va, false);
+	pml4_set_dirty(base_pml4, page->frame->kva, false);
+	/* The kernel alias is global, so it may be cached in the TLB
+	 * whichever page table is active. */
+	invlpg((uint64_t)page->frame->kva);
+}
+
+/* Prints pre-fault and swap statistics. */
+void
+vm_print_stats(void)
+{
+	printf("Prefault: %lld pages in %lld reads\n",
+		   populate_page_cnt, populate_read_cnt);
+	swap_print_stats();
+}
+
+/* Copies the paging counters of the current process into STAT.
+ * The fault and fork counters are only updated by the process
+ * itself; swap-ins and swap-outs, which other processes' evictions
+ * and read-ahead may cause, are updated under the swap table lock.
+ * The resident set is counted from the page table on each call. */
+void
+vm_get_stat(struct vmstat *stat)
+{
+	struct thread *current_thread = thread_current();
+	struct hash_iterator i;
+	long long rss = 0;
+
+	hash_first(&i, &current_thread->spt.spt_hash);
+	while (hash_next(&i))
+		if (hash_entry(hash_cur(&i), struct page, hash_elem)->frame != NULL)
+			rss++;
+	*stat = current_thread->vmstat;
+	stat->rss = rss;
+}
+
+/* Prints the paging counters of the current process, which is
+ * exiting, if the "-vmstat" option asked for them. */
+void
+vm_print_exit_stats(void)
+{
+	struct vmstat stat;
+
+	if (!vm_exit_stats)
+		return;
+	vm_get_stat(&stat);
+	printf("%s: vmstat: %lld minor faults, %lld major faults, "
+		   "%lld swap-ins, %lld swap-outs, %lld fork copies, "
+		   "%lld pages resident\n",
+		   thread_name(), stat.minor_faults, stat.major_faults,
+		   stat.swap_ins, stat.swap_outs, stat.fork_copies, stat.rss);
+}
+
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page(struct page *page)
 {
-	struct frame *frame = vm_get_frame();
-	struct thread *current_thread = thread_current();
-	/* Set links */
+	/* Read-only executable pages map a frame shared by every
+	 * process running the same file. */
+	if (VM_TYPE(page->operations->type) == VM_UNINIT &&
+		(page->uninit.type & VM_SHARED))
+		return share_claim_page(page);
+
+	for (;;)
+	{
+		/* An evictor is writing the page out, and has unmapped it or
+		 * is about to.  Reading it back before the write is done would
+		 * read stale data: wait until the evictor lets go of it. */
+		while (page->evicting)
+			thread_yield();
+
+		/* Swap read-ahead already brought the page into a frame.  It is
+		 * pinned while being mapped, so that no evictor takes it then;
+		 * if one just has, wait for it as above. */
+		if (VM_TYPE(page->operations->type) != VM_ANON ||
+			!page->anon.readahead || page->frame == NULL)
+			break;
+		struct frame *frame = page->frame;
+		if (frame_try_pin(frame))
+		{
+			bool success = swap_claim_readahead(page);
+			frame->pinned = false;
+			return success;
+		}
+		thread_yield();
+	}
+
+	/* Fresh anonymous memory (stack, zero-fill) has no initializer
+	 * to overwrite the frame, so it must start out zeroed. */
+	bool zero_fill = is_zero_fill(page);
+	struct frame *frame = vm_get_frame(zero_fill ? PAL_ZERO : 0);
+	bool success;
+	/* Set links.  The frame stays pinned until its contents are in. */
+	frame->pinned = true;
 	frame->page = page;
 	page->frame = frame;
 	bool writable = page->writable;
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
-	pml4_set_page(current_thread->pml4, page->va, frame->kva, writable);
+	pml4_set_page(page->owner->pml4, page->va, frame->kva, writable);
+
+	success = swap_in(page, frame->kva);
+	frame->pinned = false;
+	return success;
+}
 
-	return swap_in(page, frame->kva);
+/* Makes PAGE, of any process, resident, loading it if needed, and
+ * pins its frame until the caller clears the frame's pinned flag.
+ * Unlike pin_user_page(), does not need PAGE to be mapped.  Returns
+ * false if PAGE cannot be loaded. */
+static bool
+pin_page_frame(struct page *page)
+{
+	for (;;)
+	{
+		struct frame *frame = page->frame;
+		if (frame == NULL)
+		{
+			if (!vm_do_claim_page(page))
+				return false;
+		}
+		else if (frame_try_pin(frame))
+		{
+			/* Evicted and given to another page before the pin. */
+			if (page->frame == frame)
+				return true;
+			frame->pinned = false;
+		}
+		else
+			thread_yield();
+	}
 }
 
 /* Initialize new supplemental page table */
@@ -316,12 +927,31 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 			continue;
 		}
 
+		if (type & VM_SHARED)
+		{
+			if (!share_copy_page(src_page))
+				return false;
+			continue;
+		}
+
 		if (VM_TYPE(type) == VM_ANON)
 		{
-			vm_alloc_page(type, src_page->va, writable);
-			vm_claim_page(src_page->va);
-			dst_page = spt_find_page(dst, src_page->va);
-			memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
+			/* Bring a swapped-out parent page back to copy it.  Both
+			 * frames stay pinned until the copy is done: claiming the
+			 * child's frame may evict the parent's otherwise. */
+			if (!pin_page_frame(src_page))
+				return false;
+			if (!vm_alloc_page(type, src_page->va, writable) ||
+				(dst_page = spt_find_page(dst, src_page->va)) == NULL ||
+				!pin_page_frame(dst_page))
+			{
+				src_page->frame->pinned = false;
+				return false;
+			}
+			copy_page(dst_page->frame->kva, src_page->frame->kva);
+			dst_page->frame->pinned = false;
+			src_page->frame->pinned = false;
+			thread_current()->vmstat.fork_copies++;
 			continue;
 		}
 
@@ -334,7 +964,8 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 		memcpy(&dst_page->file, &src_page->file, sizeof(struct file_page));
 		dst_page->file.file = file_reopen(src_page->file.file);
 		dst_page->frame = src_page->frame;
-		pml4_set_page(thread_current()->pml4, dst_page->va, src_page->frame->kva, dst_page->writable);
+		if (src_page->frame != NULL)
+			pml4_set_page(thread_current()->pml4, dst_page->va, src_page->frame->kva, dst_page->writable);
 	}
 	return true;
 }
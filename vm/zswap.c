@@ -0,0 +1,108 @@
+/* zswap.c: Compressed in-memory cache in front of the swap disk.
+ *
+ * Anonymous pages being swapped out are compressed into kernel
+ * memory when they shrink to at most half a page and the pool has
+ * room, and only the rest go to the swap disk.  Pages full of zeros
+ * or of repeated bytes take a few dozen bytes each, so they come
+ * back on the next fault with no disk I/O at all.
+ *
+ * An entry belongs to exactly one page and is freed when the page
+ * is swapped back in or destroyed; the pool never writes entries
+ * back to disk, it just turns pages away once full. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <lz.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Largest compressed page worth keeping. */
+#define ZSWAP_MAX_SIZE (PGSIZE / 2)
+
+/* One compressed page. */
+struct zswap_entry {
+	size_t size;                /* Bytes in DATA. */
+	uint8_t data[];             /* Compressed page. */
+};
+
+size_t zswap_pool_pages;
+
+/* Protects the statistics, pool_bytes, and the scratch buffers. */
+static struct lock zswap_lock;
+static size_t pool_bytes;               /* Compressed bytes stored. */
+static uint16_t lz_table[LZ_TABLE_SIZE];
+static uint8_t lz_buf[ZSWAP_MAX_SIZE];
+
+/* Statistics. */
+static long long store_cnt;             /* Pages stored. */
+static long long reject_cnt;            /* Pages too big or no room. */
+static long long load_cnt;              /* Swap-ins served from memory. */
+static long long stored_bytes;          /* Compressed size of stores. */
+
+void
+vm_zswap_init (void) {
+	lock_init (&zswap_lock);
+}
+
+/* Compresses the page at KVA into the pool.  Returns the new entry,
+ * or a null pointer if the pool is disabled or full or the page does
+ * not compress well, in which case it belongs on the swap disk. */
+struct zswap_entry *
+zswap_store (const void *kva) {
+	struct zswap_entry *entry = NULL;
+	size_t size;
+
+	if (zswap_pool_pages == 0)
+		return NULL;
+
+	lock_acquire (&zswap_lock);
+	size = lz_compress (kva, PGSIZE, lz_buf, sizeof lz_buf, lz_table);
+	if (size != 0 && pool_bytes + size <= zswap_pool_pages * PGSIZE)
+		entry = malloc (sizeof *entry + size);
+	if (entry != NULL) {
+		entry->size = size;
+		memcpy (entry->data, lz_buf, size);
+		pool_bytes += size;
+		store_cnt++;
+		stored_bytes += size;
+	} else
+		reject_cnt++;
+	lock_release (&zswap_lock);
+	return entry;
+}
+
+/* Decompresses ENTRY into the page at KVA.  ENTRY stays in the
+ * pool until zswap_free(). */
+void
+zswap_load (struct zswap_entry *entry, void *kva) {
+	if (!lz_decompress (entry->data, entry->size, kva, PGSIZE))
+		PANIC ("zswap: corrupt entry");
+	lock_acquire (&zswap_lock);
+	load_cnt++;
+	lock_release (&zswap_lock);
+}
+
+/* Removes ENTRY from the pool. */
+void
+zswap_free (struct zswap_entry *entry) {
+	lock_acquire (&zswap_lock);
+	pool_bytes -= entry->size;
+	lock_release (&zswap_lock);
+	free (entry);
+}
+
+/* Prints pool statistics, with the hit ratio among all swap-ins,
+ * DISK_SWAP_IN_CNT of which read the swap disk. */
+void
+zswap_print_stats (long long disk_swap_in_cnt) {
+	long long swap_in_cnt = load_cnt + disk_swap_in_cnt;
+
+	printf ("Zswap: %lld pages stored in %lld bytes, %lld rejected, "
+			"%lld of %lld swap-ins (%lld%%) from memory\n",
+			store_cnt, stored_bytes, reject_cnt, load_cnt, swap_in_cnt,
+			swap_in_cnt ? load_cnt * 100 / swap_in_cnt : 0);
+}